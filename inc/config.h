@@ -72,6 +72,22 @@
  */
 #define DMA_DISABLED        0
 
+/**
+ *  \brief
+ *      Set it to 1 to enable DMA queue tracing: flushed operations can be recorded in a ring buffer and dumped through KDebug
+ *      for offline analysis (see #DMA_setTrace(..) and #DMA_dumpTrace() methods and the dmatrace tool).<br>
+ *      It slightly slows down the DMA queue and uses 4 bytes per DMA queue entry.
+ */
+#define DMA_TRACE           0
+
+/**
+ *  \brief
+ *      Set it to 1 to enable heap instrumentation: allocations are tagged (see #MEM_setTag(..)) and tracked with their call site
+ *      so you can get peak usage, per tag totals, fragmentation and leak report (see #MEM_reportLeaks(..)).<br>
+ *      It slows down MEM_alloc(..) / MEM_free(..), samples heap fragmentation on each frame and uses about 4 KB of RAM.
+ */
+#define MEM_TRACKING        0
+
 /**
  *  \brief
  *      Set it to 1 to enable automatic bank switch using official SEGA mapper for ROM > 4MB.
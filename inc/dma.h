@@ -30,8 +30,32 @@
  */
 #define DMA_VSRAM   2
 
+/**
+ *  \brief
+ *      Critical DMA queue lane (sprite table, palettes): always transferred first, never ignored.
+ */
+#define DMA_LANE_CRITICAL       0
+/**
+ *  \brief
+ *      Normal DMA queue lane (tilemaps, sprite tiles...): default lane, transferred after critical lane.
+ */
+#define DMA_LANE_NORMAL         1
+/**
+ *  \brief
+ *      Background DMA queue lane (streamed tiles...): only uses remaining capacity, unfinished transfers are
+ *      carried over to next #DMA_flushQueue() call (source data should stay valid until transferred).
+ */
+#define DMA_LANE_BACKGROUND     2
+/**
+ *  \brief
+ *      Number of DMA queue lane
+ */
+#define DMA_LANE_NUM            3
+
 #define DMA_QUEUE_SIZE_DEFAULT      64
 #define DMA_QUEUE_SIZE_MIN          20
+#define DMA_QUEUE_SIZE_CRITICAL     16
+#define DMA_QUEUE_SIZE_BACKGROUND   16
 
 #define DMA_TRANSFER_CAPACITY_NTSC  7200
 #define DMA_TRANSFER_CAPACITY_PAL   15000
@@ -39,6 +63,35 @@
 #define DMA_BUFFER_SIZE_NTSC        (8 * 1024)
 #define DMA_BUFFER_SIZE_PAL         (14 * 1024)
 #define DMA_BUFFER_SIZE_MIN         (2 * 1024)
+/**
+ *  \brief
+ *      Maximum number of temporary data buffer (see #DMA_setNumBuffer(..))
+ */
+#define DMA_BUFFER_NUM_MAX          3
+
+/**
+ *  \brief
+ *      Main BUS hold limit computed from the loaded Z80 driver (see #DMA_setBusHoldLimit(..))
+ */
+#define DMA_BUS_HOLD_AUTO           0xFFFF
+/**
+ *  \brief
+ *      Minimum main BUS hold limit (in bytes)
+ */
+#define DMA_BUS_HOLD_MIN            256
+
+/**
+ *  \brief
+ *      Number of entry of the DMA trace ring buffer (see #DMA_setTrace(..))
+ */
+#define DMA_TRACE_SIZE              256
+/**
+ *  \brief
+ *      DMA trace entry location for VRAM fill, VRAM copy and flush summary
+ */
+#define DMA_TRACE_FILL              3
+#define DMA_TRACE_COPY              4
+#define DMA_TRACE_FLUSH             0xFF
 
 
 /**
@@ -69,7 +122,40 @@ typedef struct
 
 /**
  *  \brief
- *      DMA queue structure
+ *      DMA trace entry (see #DMA_setTrace(..))
+ *
+ *  \param from
+ *      Source address (VRAM source address for #DMA_TRACE_COPY, fill value for #DMA_TRACE_FILL, capacity for #DMA_TRACE_FLUSH)
+ *  \param site
+ *      Call site (return address of the DMA queue method used to queue the operation)
+ *  \param frame
+ *      Frame (flush) number
+ *  \param to
+ *      Destination address (transferred size in bytes for #DMA_TRACE_FLUSH)
+ *  \param len
+ *      DMA length register (in word for DMA transfer, number of operation for #DMA_TRACE_FLUSH)
+ *  \param location
+ *      #DMA_VRAM, #DMA_CRAM, #DMA_VSRAM, #DMA_TRACE_FILL, #DMA_TRACE_COPY or #DMA_TRACE_FLUSH (end of flush)
+ *  \param lane
+ *      DMA queue lane
+ *  \param step
+ *      Destination address increment step
+ */
+typedef struct
+{
+    u32 from;
+    u32 site;
+    u16 frame;
+    u16 to;
+    u16 len;
+    u8 location;
+    u8 lane;
+    u16 step;
+} DMATraceEntry;
+
+/**
+ *  \brief
+ *      DMA queue structure (all lanes queues, allocated as a single block)
  */
 extern DMAOpInfo *dmaQueues;
 
@@ -89,7 +175,10 @@ void DMA_init();
  *      Initialize the DMA queue sub system.
  *
  *  \param size
- *      The queue size (0 = default size = 64, min size = 20).
+ *      The queue size for normal lane (0 = default size = 64, min size = 20).<br>
+ *      Critical lane always has 16 entries and background lane size is set with #DMA_setBackgroundQueueSize(..) (16 entries
+ *      by default) so the queue uses (16 + size + 16) * 16 bytes by default (1536 bytes), plus 4 bytes per entry when
+ *      #DMA_TRACE is enabled.
  *  \param capacity
  *      The maximum allowed size (in bytes) to transfer per #DMA_flushQueue() call (0 = default = no limit).<br>
  *      Depending the current selected strategy, furthers transfers can be ignored (by default all transfers are done whatever is the limit).
@@ -150,6 +239,26 @@ void DMA_setMaxQueueSize(u16 value);
  *  \see DMA_setMaxQueueSize()
  */
 void DMA_setMaxQueueSizeToDefault();
+/**
+ *  \brief
+ *      Returns the maximum allowed number of pending transfer in the background lane (#DMA_LANE_BACKGROUND).
+ *
+ *  \see DMA_setBackgroundQueueSize()
+ */
+u16 DMA_getBackgroundQueueSize();
+/**
+ *  \brief
+ *      Sets the maximum allowed number of pending transfer in the background lane (#DMA_LANE_BACKGROUND).<br>
+ *      The background lane is small by default (16 entries) to save memory, increase it if you stream many transfers
+ *      through it.<br>
+ *      <b>WARNING:</b> changing the queue size will clear the DMA queue.
+ *
+ *  \param value
+ *      The background lane size (0 = background lane disabled, transfers queued in it are refused)
+ *
+ *  \see DMA_getBackgroundQueueSize()
+ */
+void DMA_setBackgroundQueueSize(u16 value);
 /**
  *  \brief
  *      Returns the maximum allowed size (in bytes) to transfer per #DMA_flushQueue() call.<br>
@@ -178,6 +287,133 @@ void DMA_setMaxTransferSize(u16 value);
  *  \see DMA_setMaxTransferSize()
  */
 void DMA_setMaxTransferSizeToDefault();
+/**
+ *  \brief
+ *      Returns TRUE if the maximum amount of data to transfer per #DMA_flushQueue() call is automatically computed.
+ *
+ *  \see DMA_setAutoMaxTransferSize()
+ */
+bool DMA_getAutoMaxTransferSize();
+/**
+ *  \brief
+ *      Enable automatic maximum transfer size.<br>
+ *      When enabled the capacity is computed on each #DMA_flushQueue() call from the current display mode (H32/H40, V28/V30,
+ *      NTSC/PAL, display enabled or not, see #DMA_computeTransferCapacity(..)) minus a safety margin which increases when
+ *      transfers overrun the VBlank period and slowly decreases otherwise.<br>
+ *      When a main BUS hold limit is used (see #DMA_setBusHoldLimit(..)), the BUS release gaps between DMA windows are deducted too.<br>
+ *      The computed capacity only covers blank lines (<i>activeLines</i> = 0) as it limits what the flush transfers during VBlank:
+ *      background transfers done later by HInt slicing (see #DMA_setHIntSlicing(..)) come in addition and aren't counted
+ *      by #DMA_getLastTransferSize() / #DMA_getUtilization().<br>
+ *      Calling #DMA_setMaxTransferSize(..) disables it.
+ *
+ *  \see DMA_computeTransferCapacity()
+ *  \see DMA_getUtilization()
+ */
+void DMA_setAutoMaxTransferSize(bool value);
+/**
+ *  \brief
+ *      Computes the DMA transfer capacity (in bytes) of a frame for the given display mode.<br>
+ *      The model uses about 205 bytes per blank line in H40 (167 in H32) minus a few lines reserved for V-Int latency,
+ *      plus 18 bytes per active line in H40 (16 in H32) for lines used by active display DMA.<br>
+ *      It gives ~7.4 KB for NTSC and ~17.8 KB for PAL (224 lines, H40).
+ *
+ *  \param width
+ *      screen width in pixel (256 or 320)
+ *  \param height
+ *      number of active display line (224 or 240, 0 if display is disabled)
+ *  \param pal
+ *      TRUE for PAL system (313 lines per frame), FALSE for NTSC (262 lines per frame)
+ *  \param activeLines
+ *      number of active display line used for DMA transfer
+ */
+u16 DMA_computeTransferCapacity(u16 width, u16 height, bool pal, u16 activeLines);
+/**
+ *  \brief
+ *      Returns the size (in bytes) of data transferred on last #DMA_flushQueue() call.
+ */
+u16 DMA_getLastTransferSize();
+/**
+ *  \brief
+ *      Returns the DMA capacity utilization (in %) of last #DMA_flushQueue() call.<br>
+ *      When there is no transfer limit, the utilization is computed against the display mode capacity.
+ */
+u16 DMA_getUtilization();
+/**
+ *  \brief
+ *      Returns the main BUS hold limit (see #DMA_setBusHoldLimit(..)).
+ */
+u16 DMA_getBusHoldLimit();
+/**
+ *  \brief
+ *      Sets the maximum size (in bytes) of continuous DMA done by #DMA_flushQueue() (default is #DMA_BUS_HOLD_AUTO).<br>
+ *      The Z80 can't access the main BUS (ROM samples, 68000 RAM) while a DMA is running, a long DMA can then stall it and
+ *      alter PCM playback. When a limit is set, the flush is done by windows of at most <i>value</i> bytes (large transfers are split)
+ *      and the main BUS is given back to the Z80 for about 1 scanline between 2 windows (busy wait during the flush), which costs
+ *      about 1 scanline of DMA bandwidth per window. Automatic capacity (see #DMA_setAutoMaxTransferSize(..)) takes it into account,
+ *      a manual capacity set with #DMA_setMaxTransferSize(..) should be lowered accordingly.<br>
+ *      #DMA_BUS_HOLD_AUTO uses the loaded Z80 driver tolerance: 2 scanlines of DMA for sample drivers (PCM, 2ADPCM, 4PCM),
+ *      4 scanlines for XGM driver when #XGM_setForceDelayDMA(..) is enabled and no limit otherwise.<br>
+ *      No limit is used when the Z80 BUS is taken by the 68000 during the flush.
+ *
+ *  \param value
+ *      maximum continuous DMA size in bytes (minimum is #DMA_BUS_HOLD_MIN), 0 for no limit or #DMA_BUS_HOLD_AUTO
+ *
+ *  \see DMA_getLastBusHold()
+ */
+void DMA_setBusHoldLimit(u16 value);
+/**
+ *  \brief
+ *      Returns the size (in bytes) of the longest continuous DMA (main BUS hold) done by last #DMA_flushQueue() call.
+ */
+u16 DMA_getLastBusHold();
+/**
+ *  \brief
+ *      Enable / disable DMA queue tracing (requires <i>DMA_TRACE</i> set to 1 in config.h, does nothing otherwise).<br>
+ *      When enabled, each operation done by #DMA_flushQueue() is recorded (with the frame number and the call site which queued it)
+ *      in a ring buffer of #DMA_TRACE_SIZE entries, followed by a flush summary entry (capacity and transferred size).<br>
+ *      Background transfers done by HInt slicing (see #DMA_setHIntSlicing(..)) aren't recorded.<br>
+ *      Enabling the trace allocates the ring buffer and clears it.
+ *
+ *  \see DMA_dumpTrace()
+ */
+void DMA_setTrace(bool value);
+/**
+ *  \brief
+ *      Dumps the DMA trace ring buffer (oldest entry first) through KDebug log, one line per entry:<br>
+ *      <i>DMAT frame lane location from to len step site</i> for each operation (addresses in hexadecimal)<br>
+ *      <i>DMAF frame capacity size num</i> for each flush.<br>
+ *      The log can be replayed with the dmatrace tool (tools/dmatrace) to get per-frame bandwidth, over capacity frames and
+ *      top call sites.
+ *
+ *  \see DMA_setTrace()
+ */
+void DMA_dumpTrace();
+/**
+ *  \brief
+ *      Enable HInt slicing of background transfers.<br>
+ *      When background lane transfers (#DMA_LANE_BACKGROUND) don't fit in the VBlank capacity, the remaining ones are continued
+ *      during active display: every <i>interval</i> lines the horizontal interrupt transfers up to <i>size</i> bytes
+ *      (about 18 bytes per line are available in H40 so keep slices small), until the background lane is empty.<br>
+ *      This active display bandwidth is not part of the flush capacity (see #DMA_setAutoMaxTransferSize(..)), use
+ *      #DMA_computeTransferCapacity(..) with the number of sliced lines to estimate the whole frame capacity.<br>
+ *      Only VRAM transfers are sliced (CRAM and VSRAM writes would be visible), slicing stops on the first other one.<br>
+ *      <b>WARNING:</b> destination must be safe to write during active display (unused VRAM, off-screen tilemap area...).<br>
+ *      The horizontal interrupt (callback and counter) is used while slicing so it can't be used for something else, and
+ *      VDP accesses from main loop should be protected with #SYS_disableInts() / #SYS_enableInts() as for any HInt process.
+ *
+ *  \param size
+ *      maximum size (in bytes) transferred per slice (0 to disable HInt slicing)
+ *  \param interval
+ *      number of line between 2 slices (1 to 256)
+ *
+ *  \see DMA_queueDmaEx()
+ */
+void DMA_setHIntSlicing(u16 size, u16 interval);
+/**
+ *  \brief
+ *      Returns TRUE if background transfers are currently being sliced during active display (see #DMA_setHIntSlicing(..)).
+ */
+bool DMA_isHIntSlicing();
 /**
  *  \brief
  *      Returns the size (in bytes) of the temporary data buffer which can be used to store data
@@ -207,6 +443,52 @@ void DMA_setBufferSize(u16 value);
  *  \see DMA_setBufferSize()
  */
 void DMA_setBufferSizeToDefault();
+/**
+ *  \brief
+ *      Sets the number of temporary data buffer (default is 1).<br>
+ *      The temporary data buffer (see #DMA_setBufferSize(..)) is split in <i>num</i> buffers of equal size so producers can
+ *      fill the next frame data while transfers of the previous frame(s) are still waiting for #DMA_flushQueue().<br>
+ *      Each frame should be closed with #DMA_fence(): the next flush only processes transfers of the oldest fenced frame
+ *      then releases its data buffer. Without fence the flush processes all queued transfers as with a single buffer.<br>
+ *      <b>WARNING:</b> this method clears the DMA queue.
+ *
+ *  \param num
+ *      number of data buffer (1 to #DMA_BUFFER_NUM_MAX), 2 for double buffering and 3 for triple buffering
+ *
+ *  \see DMA_fence()
+ */
+void DMA_setNumBuffer(u16 num);
+/**
+ *  \brief
+ *      Returns the number of temporary data buffer (see #DMA_setNumBuffer(..)).
+ */
+u16 DMA_getNumBuffer();
+/**
+ *  \brief
+ *      Closes the current frame: transfers queued so far will be done by a following #DMA_flushQueue() and next
+ *      #DMA_allocateTemp(..) calls use the next data buffer.<br>
+ *      Does nothing when a single data buffer is used.
+ *
+ *  \return FALSE if all data buffers are already used by frames waiting for flush (the frame is not closed then).
+ *
+ *  \see DMA_setNumBuffer()
+ */
+bool DMA_fence();
+/**
+ *  \brief
+ *      Returns the number of fenced frames waiting for #DMA_flushQueue().
+ */
+u16 DMA_getNumFence();
+/**
+ *  \brief
+ *      Returns the data buffer high-water mark (in bytes) of the frame processed by last #DMA_flushQueue() call.
+ */
+u16 DMA_getBufferHighWater();
+/**
+ *  \brief
+ *      Returns the maximum data buffer high-water mark (in bytes) reached by a frame since #DMA_initEx(..).
+ */
+u16 DMA_getBufferMaxHighWater();
 /**
  *  \brief
  *      Return TRUE means that we ignore future DMA operation when we reach the maximum capacity (see #DMA_setIgnoreOverCapacity(..) method).
@@ -236,6 +518,9 @@ void DMA_clearQueue();
  *  \brief
  *      Transfer the content of the DMA queue to the VDP:<br>
  *      Each pending DMA operation is sent to the VDP and processed as quickly as possible.<br>
+ *      Lanes are processed by priority: critical transfers are always done, then normal transfers (which may be ignored
+ *      when maximum capacity is reached, see #DMA_setIgnoreOverCapacity(..)) and finally background transfers fitting in the
+ *      remaining capacity, others are kept for next call.<br>
  *      This method returns when all DMA operations present in the queue has been transferred (or when maximum capacity has been reached).<br>
  *      Note that this method is automatically called at VBlank time and you shouldn't call yourself except if
  *      you want to process it before vblank (if you manually extend blank period with h-int for instance) in which case
@@ -258,6 +543,21 @@ u16 DMA_getQueueSize();
  *      PAL frame allows about 17 KB (in H40).
  */
 u16 DMA_getQueueTransferSize();
+/**
+ *  \brief
+ *      Returns the size (in byte) of data to be transferred currently present in the given DMA queue lane.
+ *
+ *  \param lane
+ *      DMA queue lane (#DMA_LANE_CRITICAL, #DMA_LANE_NORMAL or #DMA_LANE_BACKGROUND)
+ */
+u16 DMA_getLaneTransferSize(u16 lane);
+/**
+ *  \brief
+ *      Returns the number of transfer merged with the previous queued transfer since #DMA_initEx(..).<br>
+ *      A transfer is merged when it extends the previous transfer of the same lane (same destination location and step,
+ *      contiguous source and destination), that saves a DMA setup on #DMA_flushQueue().
+ */
+u32 DMA_getNumMergedTransfer();
 
 /**
  *  \brief
@@ -344,6 +644,16 @@ bool DMA_transfer(TransferMethod tm, u8 location, void* from, u16 to, u16 len, u
  *  \see DMA_queueDMA(..)
  */
 void* DMA_allocateAndQueueDma(u8 location, u16 to, u16 len, u16 step);
+/**
+ *  \brief
+ *      Same as #DMA_allocateAndQueueDma(..) except the transfer is queued in the specified DMA queue lane.
+ *
+ *  \param lane
+ *      DMA queue lane: #DMA_LANE_CRITICAL or #DMA_LANE_NORMAL.<br>
+ *      Temporary buffer is released on flush so #DMA_LANE_BACKGROUND isn't allowed here (normal lane is used instead).
+ *  \see DMA_allocateAndQueueDma(..)
+ */
+void* DMA_allocateAndQueueDmaEx(u8 location, u16 to, u16 len, u16 step, u16 lane);
 /**
  *  \brief
  *      Same as #DMA_queueDma(..) method except that it first copies the data to transfer through DMA queue into a temporary buffer.<br>
@@ -374,6 +684,7 @@ bool DMA_copyAndQueueDma(u8 location, void* from, u16 to, u16 len, u16 step);
  *  \brief
  *      Queues the specified DMA transfer operation in the DMA queue.<br>
  *      The idea of the DMA queue is to burst all DMA operations during VBLank to maximize bandwidth usage.<br>
+ *      A transfer which extends the previous queued one (same location and step, contiguous source and destination) is merged with it.<br>
  *
  *  \param location
  *      Destination location.<br>
@@ -396,6 +707,71 @@ bool DMA_copyAndQueueDma(u8 location, void* from, u16 to, u16 len, u16 step);
  *  \see DMA_do(..)
  */
 bool DMA_queueDma(u8 location, void* from, u16 to, u16 len, u16 step);
+/**
+ *  \brief
+ *      Same as #DMA_queueDma(..) except the transfer is queued in the specified DMA queue lane (#DMA_queueDma(..) uses #DMA_LANE_NORMAL).<br>
+ *      Transfers of a same lane are always done in queue order.
+ *
+ *  \param lane
+ *      DMA queue lane:<br>
+ *      #DMA_LANE_CRITICAL = always transferred first, never ignored.<br>
+ *      #DMA_LANE_NORMAL = transferred after critical lane.<br>
+ *      #DMA_LANE_BACKGROUND = transferred with the remaining capacity, carried over to next flush otherwise
+ *      (source data should stay valid until transferred, don't use the DMA temporary buffer).
+ *  \return
+ *      FALSE if the operation failed (lane queue is full or transfer will be ignored because of capacity limit)
+ *  \see DMA_queueDma(..)
+ */
+bool DMA_queueDmaEx(u8 location, void* from, u16 to, u16 len, u16 step, u16 lane);
+/**
+ *  \brief
+ *      Queues a VRAM DMA fill operation: same as #DMA_doVRamFill(..) except the fill is done on next #DMA_flushQueue() call,
+ *      in queue order with the other transfers of the lane (#DMA_LANE_NORMAL).<br>
+ *      The CPU doesn't busy-wait the fill completion (the flush only waits it before next VDP access).
+ *
+ *  \param to
+ *      VRAM destination address.
+ *  \param len
+ *      Number of byte to fill (minimum is 2 for even addr destination and 3 for odd addr destination).<br>
+ *      A value of 0 mean 0x10000.
+ *  \param value
+ *      Fill value (byte).
+ *  \param step
+ *      VRAM address increment step after each write (0 to 255), should be 1 for a classic fill operation.
+ *  \return
+ *      FALSE if the operation failed (queue is full or operation will be ignored because of capacity limit)
+ *  \see DMA_queueVRamFillEx(..)
+ */
+bool DMA_queueVRamFill(u16 to, u16 len, u8 value, u16 step);
+/**
+ *  \brief
+ *      Same as #DMA_queueVRamFill(..) except the operation is queued in the specified DMA queue lane (see #DMA_queueDmaEx(..)).
+ */
+bool DMA_queueVRamFillEx(u16 to, u16 len, u8 value, u16 step, u16 lane);
+/**
+ *  \brief
+ *      Queues a VRAM DMA copy operation: same as #DMA_doVRamCopy(..) except the copy is done on next #DMA_flushQueue() call,
+ *      in queue order with the other transfers of the lane (#DMA_LANE_NORMAL).<br>
+ *      VRAM copy is about twice slower than a 68000 DMA transfer so it's counted as 2 bytes per copied byte for the capacity limit.
+ *
+ *  \param from
+ *      VRAM Source address.
+ *  \param to
+ *      VRAM destination address.
+ *  \param len
+ *      Number of byte to copy.
+ *  \param step
+ *      VRAM address increment step after each write (0 to 255), should be 1 for a classic copy operation.
+ *  \return
+ *      FALSE if the operation failed (queue is full or operation will be ignored because of capacity limit)
+ *  \see DMA_queueVRamCopyEx(..)
+ */
+bool DMA_queueVRamCopy(u16 from, u16 to, u16 len, u16 step);
+/**
+ *  \brief
+ *      Same as #DMA_queueVRamCopy(..) except the operation is queued in the specified DMA queue lane (see #DMA_queueDmaEx(..)).
+ */
+bool DMA_queueVRamCopyEx(u16 from, u16 to, u16 len, u16 step, u16 lane);
 /**
  *  \brief
  *      Do DMA transfer operation immediately
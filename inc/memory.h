@@ -43,6 +43,85 @@
  */
 #define MEMORY_HIGH     (0x01000000 - STACK_SIZE)
 
+/**
+ *  \brief
+ *      Allocation tags used by SGDK modules (see #MEM_setTag(..)), user tags should start from #MEM_TAG_USER_START
+ */
+#define MEM_TAG_USER        0
+#define MEM_TAG_SYS         1
+#define MEM_TAG_DMA         2
+#define MEM_TAG_SPRITE      3
+#define MEM_TAG_MAP         4
+#define MEM_TAG_USER_START  8
+/**
+ *  \brief
+ *      Number of allocation tags (per tag totals)
+ */
+#define MEM_TAG_NUM         16
+/**
+ *  \brief
+ *      Maximum number of tracked allocations (when MEM_TRACKING is enabled)
+ */
+#define MEM_TRACK_SIZE      256
+
+
+/**
+ *  \brief
+ *      Memory arena (linear allocator) structure.
+ *
+ *  \param start
+ *      start of arena memory block
+ *  \param end
+ *      end of arena memory block
+ *  \param current
+ *      next allocation position
+ *
+ * An arena is a memory block allocated once from the heap where allocations are done by simply moving a pointer,
+ * all allocations are released at once by clearing or releasing the arena (see #MEM_createArena(..)).
+ */
+typedef struct
+{
+    u8 *start;
+    u8 *end;
+    u8 *current;
+} MemArena;
+
+/**
+ *  \brief
+ *      Fixed size object pool structure.
+ *
+ *  \param bank
+ *      objects bank (num * size bytes)
+ *  \param slots
+ *      object pointers: [0 - numLive[ are allocated (live) objects, [numLive - num[ are free objects
+ *  \param slotIndex
+ *      object index for each slot
+ *  \param slotPos
+ *      slot position for each object
+ *  \param size
+ *      size of an object in bytes
+ *  \param num
+ *      number of object in the pool
+ *  \param numLive
+ *      number of allocated (live) objects
+ *  \param peak
+ *      maximum number of allocated objects (since last clear)
+ *
+ * Allocation and release of an object are done in constant time and live objects can be iterated directly
+ * from the slots array (see #MEM_createPool(..)).
+ */
+typedef struct
+{
+    u8 *bank;
+    void **slots;
+    u16 *slotIndex;
+    u16 *slotPos;
+    u16 size;
+    u16 num;
+    u16 numLive;
+    u16 peak;
+} MemPool;
+
 
 /**
  *  \brief
@@ -180,7 +259,10 @@ u16  MEM_getLargestFreeBlock();
  *      If a null pointer is passed as argument, no action occurs.
  *
  * A block of memory previously allocated using a call to Mem_alloc is deallocated, making it available again for further allocations.
- * Notice that this function leaves the value of ptr unchanged, hence it still points to the same (now invalid) location, and not to the null pointer.
+ * Notice that this function leaves the value of ptr unchanged, hence it still points to the same (now invalid) location, and not to the null pointer.<br>
+ * When error logging is enabled, releasing an already released block is detected and ignored (an error is logged).<br>
+ * Otherwise only releasing again the last released small block (up to 64 bytes) is detected and ignored, any other double
+ * free has undefined behavior (the block may be returned twice by #MEM_alloc(..)).
  */
 void MEM_free(void *ptr);
 /**
@@ -195,16 +277,48 @@ void MEM_free(void *ptr);
  *      If the function failed to allocate the requested block of memory (or if specified size = 0), a <i>NULL</i> pointer is returned.
  *
  * Allocates a block of size bytes of memory, returning a pointer to the beginning of the block.
- * The content of the newly allocated block of memory is not initialized, remaining with indeterminate values.
+ * The content of the newly allocated block of memory is not initialized, remaining with indeterminate values.<br>
+ * Small blocks (up to 64 bytes) are allocated by size class of 4 bytes and recycled through free lists so allocating
+ * and releasing them is done in constant time most of the time.
  */
 void* MEM_alloc(u16 size);
 
 /**
  *  \brief
  *      Pack all free blocks and reset allocation search from start of heap.<br>
+ *      Released small blocks kept in size class free lists are given back to the heap first.<br>
  *      You can call this method before trying to allocate small block of memory to reduce memory fragmentation.
  */
 void MEM_pack();
+/**
+ *  \brief
+ *      Incremental version of #MEM_pack(), visit at most the given number of memory blocks and merge adjacent free blocks.
+ *
+ *  \param maxBlock
+ *      Maximum number of memory block to visit for this step.
+ *  \return
+ *      TRUE when a complete heap pass has been done without any merge (heap is packed).
+ *
+ * Packing continues from where the previous step stopped so the whole heap is packed after enough calls while each
+ * call has a bounded execution time. That prevents #MEM_alloc(..) from doing a full heap pack in the middle of a frame.<br>
+ * Released small blocks kept in size class free lists are not given back to the heap.
+ *
+ * \see MEM_setAutoPack(..)
+ */
+bool MEM_packStep(u16 maxBlock);
+/**
+ *  \brief
+ *      Enable automatic incremental heap packing at the end of #SYS_doVBlankProcess().
+ *
+ *  \param maxBlockPerFrame
+ *      Maximum number of memory block visited per frame (see #MEM_packStep(..)), 0 to disable it (default).
+ */
+void MEM_setAutoPack(u16 maxBlockPerFrame);
+/**
+ *  \brief
+ *      Automatic incremental heap packing step, called at the end of #SYS_doVBlankProcess().
+ */
+void MEM_doAutoPack();
 /**
  *  \brief
  *      Show memory dump
@@ -213,6 +327,277 @@ void MEM_pack();
  */
 void MEM_dump();
 
+/**
+ *  \brief
+ *      Return heap fragmentation in percent (0 = all free memory is in a single block).
+ *
+ * Computed from #MEM_getLargestFreeBlock() / #MEM_getFree() ratio (released small blocks kept for fast recycling aren't counted as free memory here).
+ */
+u16 MEM_getFragmentation();
+
+/**
+ *  \brief
+ *      Set the tag used for next allocations (MEM_TRACKING needs to be enabled in config.h).
+ *
+ *  \param tag
+ *      Allocation tag (module id), from 0 to #MEM_TAG_NUM-1 (user tags should start from #MEM_TAG_USER_START)
+ *  \return
+ *      previous tag so it can be restored.
+ *
+ * SGDK modules set their own tag during their initialization (#MEM_TAG_DMA, #MEM_TAG_SPRITE...) so you can see
+ * how much memory each of them uses (see #MEM_getTagAllocated(..)).
+ */
+u16 MEM_setTag(u16 tag);
+/**
+ *  \brief
+ *      Return the number of bytes currently allocated with the specified tag (heap block size, MEM_TRACKING needs to be enabled).
+ */
+u16 MEM_getTagAllocated(u16 tag);
+/**
+ *  \brief
+ *      Return the maximum number of bytes allocated at once since last #MEM_resetStats() (MEM_TRACKING needs to be enabled).<br>
+ *      Useful to size the heap precisely.
+ */
+u16 MEM_getPeakAllocated();
+/**
+ *  \brief
+ *      Return the worst heap fragmentation (in percent) sampled on each frame since last #MEM_resetStats() (MEM_TRACKING needs to be enabled).
+ */
+u16 MEM_getWorstFragmentation();
+/**
+ *  \brief
+ *      Reset peak allocated size and worst fragmentation statistics.
+ */
+void MEM_resetStats();
+/**
+ *  \brief
+ *      Sample heap statistics (fragmentation), automatically called at the end of #SYS_doVBlankProcess() when MEM_TRACKING is enabled.
+ */
+void MEM_sampleStats();
+/**
+ *  \brief
+ *      Return a checkpoint (allocation serial number) to be used with #MEM_reportLeaks(..)
+ */
+u16 MEM_checkpoint();
+/**
+ *  \brief
+ *      Report blocks allocated between two checkpoints which are still allocated (MEM_TRACKING needs to be enabled).
+ *
+ *  \param from
+ *      start checkpoint (see #MEM_checkpoint())
+ *  \param to
+ *      end checkpoint (see #MEM_checkpoint())
+ *  \return
+ *      number of leaked blocks
+ *
+ * Each leaked block is logged through KDebug as "MEML serial size tag address site" where site is the return address
+ * of the MEM_alloc(..) call (use out/symbol.txt to find the caller).<br>
+ * Ex:<br>
+ * <code>
+ *   u16 start = MEM_checkpoint();<br>
+ *   loadLevel(); unloadLevel();<br>
+ *   MEM_reportLeaks(start, MEM_checkpoint());
+ * </code>
+ */
+u16 MEM_reportLeaks(u16 from, u16 to);
+
+/**
+ *  \brief
+ *      Initialize a new memory arena.
+ *
+ *  \param arena
+ *      Arena to initialize.
+ *  \param size
+ *      Size in bytes of the arena.
+ *  \return
+ *      FALSE if there is not enough memory to allocate the arena block.
+ *
+ * Allocate the arena memory block from the heap in a single allocation.<br>
+ * Allocating all the data of a level (unpacked tilesets, tilemaps, map buffers...) from an arena then releasing
+ * the whole arena at once on level exit prevents heap fragmentation.
+ *
+ * \see MEM_releaseArena(..)
+ * \see MEM_allocArena(..)
+ */
+bool MEM_createArena(MemArena *arena, u16 size);
+/**
+ *  \brief
+ *      Release the memory arena (all its allocations are released).
+ *
+ *  \param arena
+ *      Arena we want to release.
+ *
+ * \see MEM_createArena(..)
+ */
+void MEM_releaseArena(MemArena *arena);
+/**
+ *  \brief
+ *      Release all allocations from specified memory arena (the arena memory block is kept).
+ *
+ *  \param arena
+ *      Arena we want to clear.
+ */
+void MEM_clearArena(MemArena *arena);
+/**
+ *  \brief
+ *      Return the number of free bytes remaining in the specified memory arena.
+ */
+u16 MEM_getArenaFree(MemArena *arena);
+/**
+ *  \brief
+ *      Return the number of allocated bytes in the specified memory arena.
+ */
+u16 MEM_getArenaAllocated(MemArena *arena);
+/**
+ *  \brief
+ *      Allocate memory block from a memory arena.
+ *
+ *  \param arena
+ *      Arena where we want to allocate memory.
+ *  \param size
+ *      Number of bytes to allocate (allocation is 2 bytes aligned).
+ *  \return
+ *      On success, a pointer to the allocated memory block (can't be released individually).<br>
+ *      <i>NULL</i> if there is not enough memory remaining in the arena (or if specified size = 0).
+ *
+ * \see MEM_clearArena(..)
+ */
+void* MEM_allocArena(MemArena *arena, u16 size);
+
+/**
+ *  \brief
+ *      Set the size of the per frame scratch memory arena (default is 0 = no frame arena).
+ *
+ *  \param size
+ *      Size in bytes of the frame arena, 0 to release it.
+ *  \return
+ *      FALSE if there is not enough memory to allocate the frame arena.
+ *
+ * The frame arena is cleared automatically at the end of #SYS_doVBlankProcess() (after the DMA queue flush)
+ * so memory allocated with #MEM_allocFrame(..) is only valid until next VBlank process.<br>
+ * <b>WARNING:</b> don't use it as source for DMA transfers which may be done after the next VBlank process
+ * (background DMA lane, fenced frames or disabled DMA auto flush).
+ *
+ * \see MEM_allocFrame(..)
+ */
+bool MEM_setFrameArenaSize(u16 size);
+/**
+ *  \brief
+ *      Allocate memory block from the per frame scratch arena (see #MEM_setFrameArenaSize(..)).
+ *
+ *  \param size
+ *      Number of bytes to allocate.
+ *  \return
+ *      On success, a pointer to the allocated memory block, valid until next #SYS_doVBlankProcess().<br>
+ *      <i>NULL</i> if there is not enough memory remaining in the frame arena (or if there is no frame arena).
+ */
+void* MEM_allocFrame(u16 size);
+/**
+ *  \brief
+ *      Release all allocations from the per frame scratch arena.<br>
+ *      Automatically called at the end of #SYS_doVBlankProcess().
+ */
+void MEM_clearFrameArena();
+
+/**
+ *  \brief
+ *      Initialize a new fixed size object pool.
+ *
+ *  \param pool
+ *      Pool to initialize.
+ *  \param size
+ *      Size in bytes of an object (rounded up to 2 bytes).
+ *  \param num
+ *      Number of object in the pool.
+ *  \return
+ *      FALSE if there is not enough memory to allocate the pool.
+ *
+ * The pool (objects bank and bookkeeping) is allocated from the heap in a single block and objects are
+ * stored contiguously in <i>pool->bank</i> so object index can be retrieved from its address.<br>
+ * Object allocation and release are done in constant time without any per object header, that make it
+ * ideal for entities, bullets or particles.
+ *
+ * \see MEM_releasePool(..)
+ * \see MEM_allocPool(..)
+ */
+bool MEM_createPool(MemPool *pool, u16 size, u16 num);
+/**
+ *  \brief
+ *      Release the object pool memory (all objects are released).
+ *
+ *  \param pool
+ *      Pool we want to release.
+ */
+void MEM_releasePool(MemPool *pool);
+/**
+ *  \brief
+ *      Release all objects from the specified pool (object content is not cleared).
+ *
+ *  \param pool
+ *      Pool we want to clear.
+ *
+ * Objects are then allocated in bank order (first object of the bank first).
+ */
+void MEM_clearPool(MemPool *pool);
+/**
+ *  \brief
+ *      Allocate an object from the specified pool.
+ *
+ *  \param pool
+ *      Pool where we want to allocate an object.
+ *  \return
+ *      On success, a pointer to the allocated object (content is not cleared).<br>
+ *      <i>NULL</i> if there is no more free object in the pool.
+ *
+ * Last released object is allocated first so used objects tend to stay packed at bank start.
+ */
+void* MEM_allocPool(MemPool *pool);
+/**
+ *  \brief
+ *      Release an object to the specified pool.
+ *
+ *  \param pool
+ *      Pool the object was allocated from.
+ *  \param obj
+ *      Object to release.
+ *
+ * The last live object takes the slot of the released one, so when releasing objects while iterating live
+ * objects (see #MEM_getPoolLive(..)) you should iterate from the end.
+ */
+void MEM_freePool(MemPool *pool, void *obj);
+/**
+ *  \brief
+ *      Return the array of live (allocated) objects of the specified pool (#MEM_getPoolNumLive(..) entries).
+ *
+ * Ex:<br>
+ * <code>
+ *   void** objs = MEM_getPoolLive(&pool);<br>
+ *   u16 i = MEM_getPoolNumLive(&pool);<br>
+ *   while(i--) updateBullet(objs[i]);
+ * </code>
+ */
+void** MEM_getPoolLive(MemPool *pool);
+/**
+ *  \brief
+ *      Return the number of live (allocated) objects in the specified pool.
+ */
+u16 MEM_getPoolNumLive(MemPool *pool);
+/**
+ *  \brief
+ *      Return the number of free objects in the specified pool.
+ */
+u16 MEM_getPoolFree(MemPool *pool);
+/**
+ *  \brief
+ *      Return the maximum number of live objects reached by the specified pool since last clear.
+ */
+u16 MEM_getPoolPeak(MemPool *pool);
+/**
+ *  \brief
+ *      Return the index of the specified object in the pool bank.
+ */
+u16 MEM_getPoolIndex(MemPool *pool, void *obj);
+
 #if (ENABLE_NEWLIB == 0)
 /**
  *  \brief
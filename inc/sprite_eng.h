@@ -15,6 +15,7 @@
 #include "vdp_tile.h"
 #include "vdp_spr.h"
 #include "pal.h"
+#include "maths.h"
 
 
 /**
@@ -71,11 +72,59 @@
  *      Enable automatic upload of sprite tiles data into VRAM
  */
 #define SPR_FLAG_AUTO_TILE_UPLOAD               0x0100
+/**
+ *  \brief
+ *      Enable shared tiles: sprites displaying the same animation frame share the same VRAM tiles (uploaded once).<br>
+ *      VRAM is allocated per frame and reference counted (released when last sprite using it changes frame).<br>
+ *      Replace #SPR_FLAG_AUTO_VRAM_ALLOC and implies #SPR_FLAG_AUTO_TILE_UPLOAD.
+ */
+#define SPR_FLAG_SHARED_TILES                   0x0080
 /**
  *  \brief
  *      Mask for sprite flag
  */
-#define SPR_FLAG_MASK                           (SPR_FLAG_DISABLE_DELAYED_FRAME_UPDATE | SPR_FLAG_AUTO_VISIBILITY | SPR_FLAG_FAST_AUTO_VISIBILITY | SPR_FLAG_AUTO_VRAM_ALLOC | SPR_FLAG_AUTO_SPRITE_ALLOC | SPR_FLAG_AUTO_TILE_UPLOAD)
+#define SPR_FLAG_MASK                           (SPR_FLAG_DISABLE_DELAYED_FRAME_UPDATE | SPR_FLAG_AUTO_VISIBILITY | SPR_FLAG_FAST_AUTO_VISIBILITY | SPR_FLAG_AUTO_VRAM_ALLOC | SPR_FLAG_AUTO_SPRITE_ALLOC | SPR_FLAG_AUTO_TILE_UPLOAD | SPR_FLAG_SHARED_TILES)
+
+/**
+ *  \brief
+ *      Sprite Engine init flag: defer depth sorting to #SPR_update().<br>
+ *      By default a sprite is immediately re-inserted in the sorted list when its depth changes (cheap for a few sprites),
+ *      with this flag #SPR_setDepth(..) only stores the new depth and the whole list is radix sorted once in #SPR_update()
+ *      (much faster when many sprites change depth on the same frame).
+ */
+#define SPR_INIT_FLAG_DEFERRED_SORT             0x0001
+/**
+ *  \brief
+ *      Sprite Engine init flag: enable sprite multiplexing.<br>
+ *      Allow up to #SPR_MULTIPLEX_MAX_SPRITE sprites, hardware sprites are assigned on each #SPR_update() taking care of
+ *      the scanline limits (20 sprites / 320 pixels per line in H40 mode), sprites which can't be displayed are dropped
+ *      and get priority on next update (flickering instead of permanent loss).
+ */
+#define SPR_INIT_FLAG_MULTIPLEX                 0x0002
+/**
+ *  \brief
+ *      Sprite Engine init flag: enable global animation tick mode.<br>
+ *      Instead of decrementing a timer per sprite, the current frame of an automatic animation is computed from the animation
+ *      timeline (generated by rescomp) and a global tick counter, only for visible sprites. Hidden animated sprites then cost
+ *      nothing per frame and catch up their animation when they become visible.<br>
+ *      Tick counter is 16 bit and animation start is rebased on each loop, so only a sprite not processed for more than
+ *      65536 #SPR_update() calls (about 18 minutes at 60 FPS) can lose its animation phase.
+ */
+#define SPR_INIT_FLAG_GLOBAL_ANIM_TICK          0x0004
+/**
+ *  \brief
+ *      Sprite Engine init flag: enable alternative cutting selection (requires #SPR_INIT_FLAG_MULTIPLEX).<br>
+ *      When hardware sprites or scanline budget are short (sprites dropped, band saturated), frames which have an alternative
+ *      cutting (rescomp <i>altcut</i> option: less but larger VDP sprites) are switched to it, and switched back once the
+ *      pressure has stayed low for a while. Only applies to sprites using #SPR_FLAG_AUTO_TILE_UPLOAD (tiles differ between cuttings).
+ */
+#define SPR_INIT_FLAG_ALT_CUTTING               0x0008
+
+/**
+ *  \brief
+ *      Maximum number of sprite in multiplexing mode (see #SPR_INIT_FLAG_MULTIPLEX)
+ */
+#define SPR_MULTIPLEX_MAX_SPRITE                128
 
 /**
  *  \brief
@@ -228,8 +277,10 @@ typedef struct
  *      frame information for [base, hflip, vflip, hvflip] version of the sprite
  *  \param tileset
  *      tileset containing tiles for this animation frame (ordered for sprite)
+ *  \param alt
+ *      alternative cutting of this frame using less VDP sprites (NULL if none)
  */
-typedef struct
+typedef struct _animationFrame
 {
     u8 numSprite;               // we use u8 to not waste ROM space
     u8 w;
@@ -237,6 +288,7 @@ typedef struct
     u8 timer;
     FrameInfo frameInfos[4];    // TODO: it would be nice to optimize that, maybe compute it on runtime
     TileSet* tileset;           // TODO: have a tileset per VDP sprite (when rescomp will be optimized for better LZ4W compression)
+    struct _animationFrame* alt;
 } AnimationFrame;
 
 /**
@@ -253,6 +305,10 @@ typedef struct
  *      frame sequence animation (for instance: 0-1-2-2-1-2-3-4..)
  *  \param loop
  *      frame sequence index for loop (last index if no loop)
+ *  \param timeline
+ *      start tick of each frame sequence step (NULL if animation isn't automatic)
+ *  \param duration
+ *      total duration of the frame sequence (in number of #SPR_update() call, 0 if animation isn't automatic)
  */
 typedef struct
 {
@@ -261,6 +317,8 @@ typedef struct
     u16 length;
     u8* sequence;
     s16 loop;
+    u16* timeline;
+    u16 duration;
 } Animation;
 
 /**
@@ -309,7 +367,7 @@ typedef struct
  *  \param seqInd
  *      current frame animation sequence index (internal)
  *  \param timer
- *      timer for current frame (internal)
+ *      timer for current frame, or animation start tick in global animation tick mode (internal)
  *  \param x
  *      current sprite X position on screen offseted by 0x80 (internal VDP position)
  *  \param y
@@ -327,6 +385,8 @@ typedef struct
  *      the number of VDP sprite used by the current frame (internal)
  *  \param lastVDPSprite
  *      Pointer to last VDP sprite used by this Sprite (used internally to update link between sprite)
+ *  \param index
+ *      position of this Sprite in the Sprite Engine bank (internal)
  *  \param data
  *      this is a free field for user data, use it for whatever you want (flags, pointer...)
  *  \param prev
@@ -357,11 +417,62 @@ typedef struct _Sprite
     VDPSprite* lastVDPSprite;
     u16 lastNumSprite;
     u16 spriteToHide;
+    u16 index;
     u32 data;
     struct _Sprite* prev;
     struct _Sprite* next;
 } Sprite;
 
+/**
+ *  \brief
+ *      Number of frame kept in the Sprite Engine runtime statistics history (see #SPR_getFrameStats(..))
+ */
+#define SPR_STATS_HISTORY       16
+
+/**
+ *  \brief
+ *      Sprite Engine runtime statistics for one #SPR_update() call.
+ *
+ *  \param spriteProcessed
+ *      number of sprite processed (hot sprites)
+ *  \param frameUpdate
+ *      number of animation frame update
+ *  \param frameDeferred
+ *      number of deferred frame update (DMA capacity or tiles upload budget exceeded)
+ *  \param visibilityUpdate
+ *      number of visibility computation
+ *  \param sort
+ *      number of depth sort operation (single sprite sort or whole list deferred sort)
+ *  \param tileUpload
+ *      sprite tiles data queued for upload (in bytes)
+ *  \param sortTime
+ *      deferred sort cost (in sub tick, see getSubTick())
+ *  \param processTime
+ *      sprites processing cost (frame, visibility and sprite table update) in sub tick
+ *  \param tableTime
+ *      sprite table upload (and multiplexing) cost in sub tick
+ *  \param tileTime
+ *      tiles upload cost in sub tick
+ *  \param totalTime
+ *      whole #SPR_update() cost in sub tick
+ *
+ *  Counters also include work done outside #SPR_update() since previous call (#SPR_setDepth(..), #SPR_computeVisibility(..)...)
+ */
+typedef struct
+{
+    u16 spriteProcessed;
+    u16 frameUpdate;
+    u16 frameDeferred;
+    u16 visibilityUpdate;
+    u16 sort;
+    u16 tileUpload;
+    u16 sortTime;
+    u16 processTime;
+    u16 tableTime;
+    u16 tileTime;
+    u16 totalTime;
+} SpriteFrameStats;
+
 /**
  *  \brief
  *      Sprite frame change event callback.<br>
@@ -404,10 +515,35 @@ void SPR_init();
  *      This allocates a VRAM region for sprite tiles, memory for tileset unpacking and initialize
  *      hardware sprite allocation system.
  *
+ *  \see SPR_initEx2()
  *  \see SPR_init()
  *  \see SPR_end()
  */
 void SPR_initEx(u16 vramSize);
+/**
+ *  \brief
+ *      Same as #SPR_initEx(..) with additional Sprite Engine settings.
+ *
+ *  \param vramSize
+ *      size (in tile) of the VRAM region for the automatic VRAM tile allocation.<br>
+ *      If set to 0 the default size is used (512 tiles)
+ *  \param flag
+ *      Sprite Engine settings:<br>
+ *      #SPR_INIT_FLAG_DEFERRED_SORT = sort sprites on depth once per #SPR_update() instead of on each #SPR_setDepth(..) call.<br>
+ *      #SPR_INIT_FLAG_MULTIPLEX = enable sprite multiplexing (more sprites than hardware sprites, overflow flickers).<br>
+ *      #SPR_INIT_FLAG_GLOBAL_ANIM_TICK = compute animation frame from a global tick counter (only for visible sprites).<br>
+ *      #SPR_INIT_FLAG_ALT_CUTTING = use frames alternative cutting (less VDP sprites) under hardware sprite pressure.<br>
+ *      Use 0 for default settings.
+ *
+ *      Initialize the sprite engine.<br>
+ *      This allocates a VRAM region for sprite tiles, memory for tileset unpacking and initialize
+ *      hardware sprite allocation system.<br>
+ *      If memory allocation fails the sprite engine stays uninitialized (see #SPR_isInitialized()).
+ *
+ *  \see SPR_initEx()
+ *  \see SPR_end()
+ */
+void SPR_initEx2(u16 vramSize, u16 flag);
 /**
  *  \brief
  *      End the Sprite engine.
@@ -461,6 +597,9 @@ void SPR_reset();
  *          If you don't set this flag you will have to manually define the hardware sprite table index to reserve with the <i>spriteIndex</i> parameter or by using the #SPR_setSpriteTableIndex(..) method<br>
  *      #SPR_FLAG_AUTO_TILE_UPLOAD = Enable automatic upload of sprite tiles data into VRAM (enabled by default)<br>
  *          If you don't set this flag you will have to manually upload tiles data of sprite into the VRAM (you can change this setting using #SPR_setAutoTileUpload(..) method).<br>
+ *      #SPR_FLAG_SHARED_TILES = Share VRAM tiles with others sprites displaying the same animation frame (disabled by default)<br>
+ *          VRAM is allocated per frame instead of per sprite and tiles are uploaded only once, useful for many identical sprites.
+ *          The shared tiles cache is allocated on first use (sprite uses its own VRAM tiles if there is not enough memory).<br>
  *      #SPR_FLAG_INSERT_HEAD = Allow to insert the sprite at the start/head of the list.<br>
  *          When you use this flag the sprite will be inserted at the head of the list making it top most (equivalent to #SPR_setDepth(#SPR_MIN_DEPTH))<br>
  *          while default insertion position is at the end of the list (equivalent to #SPR_setDepth(#SPR_MAX_DEPTH))<br>
@@ -536,6 +675,9 @@ Sprite* SPR_addSprite(const SpriteDefinition* spriteDef, s16 x, s16 y, u16 attri
  *          If you don't set this flag you will have to manually define the hardware sprite table index to reserve with the <i>spriteIndex</i> parameter or by using the #SPR_setSpriteTableIndex(..) method<br>
  *      #SPR_FLAG_AUTO_TILE_UPLOAD = Enable automatic upload of sprite tiles data into VRAM (enabled by default)<br>
  *          If you don't set this flag you will have to manually upload tiles data of sprite into the VRAM (you can change this setting using #SPR_setAutoTileUpload(..) method).<br>
+ *      #SPR_FLAG_SHARED_TILES = Share VRAM tiles with others sprites displaying the same animation frame (disabled by default)<br>
+ *          VRAM is allocated per frame instead of per sprite and tiles are uploaded only once, useful for many identical sprites.
+ *          The shared tiles cache is allocated on first use (sprite uses its own VRAM tiles if there is not enough memory).<br>
  *      #SPR_FLAG_INSERT_HEAD = Allow to insert the sprite at the start/head of the list.<br>
  *          When you use this flag the sprite will be inserted at the head of the list making it top most (equivalent to #SPR_setDepth(#SPR_MIN_DEPTH))<br>
  *          while default insertion position is at the end of the list (equivalent to #SPR_setDepth(#SPR_MAX_DEPTH))<br>
@@ -576,6 +718,32 @@ Sprite* SPR_addSpriteExSafe(const SpriteDefinition* spriteDef, s16 x, s16 y, u16
  *  \see SPR_releaseSprite(..)
  */
 Sprite* SPR_addSpriteSafe(const SpriteDefinition* spriteDef, s16 x, s16 y, u16 attribut);
+/**
+ *  \brief
+ *      Adds several sprites at once using the same definition, attribut and flag (see #SPR_addSpriteEx(..)).
+ *
+ *  \param sprites
+ *      Array receiving the added sprites
+ *  \param spriteDef
+ *      the SpriteDefinition data of the sprites
+ *  \param positions
+ *      Array of sprite position (x, y), one per sprite
+ *  \param num
+ *      Number of sprite to add
+ *  \param attribut
+ *      sprite attribut (see #SPR_addSpriteEx(..))
+ *  \param flag
+ *      specific settings for these sprites (see #SPR_addSpriteEx(..))
+ *  \return
+ *      the number of sprite really added (stop on first allocation failure), only this number of entries is set in <i>sprites</i>.
+ *
+ *  New sprites are inserted in the sprite list at once (head or tail depending #SPR_FLAG_INSERT_HEAD) so this is faster than
+ *  adding sprites one by one.<br>
+ *  Particle style workloads should combine it with #SPR_FLAG_SHARED_TILES so all sprites use the same VRAM tiles.
+ *
+ *  \see SPR_releaseSprites(..)
+ */
+u16 SPR_addSprites(Sprite** sprites, const SpriteDefinition* spriteDef, const Vect2D_s16* positions, u16 num, u16 attribut, u16 flag);
 
 /**
  *  \brief
@@ -589,16 +757,71 @@ Sprite* SPR_addSpriteSafe(const SpriteDefinition* spriteDef, s16 x, s16 y, u16 a
  *  \see SPR_releasesSprite(..)
  */
 void SPR_releaseSprite(Sprite* sprite);
+/**
+ *  \brief
+ *      Release several sprites at once (see #SPR_releaseSprite(..)).
+ *
+ *  \param sprites
+ *      Sprites to release
+ *  \param num
+ *      Number of sprite to release
+ *
+ *  Sprites are removed from the sprite list first then VDP sprite links are fixed in a second pass.<br>
+ *  NULL entries are ignored.
+ */
+void SPR_releaseSprites(Sprite** sprites, u16 num);
 /**
  *  \brief
  *      Returns the number of active sprite (number of sprite added with SPR_addSprite(..) or SPR_addSpriteEx(..) methods).
  */
 u16 SPR_getNumActiveSprite();
+/**
+ *  \brief
+ *      Returns the number of sprite which couldn't be displayed on last #SPR_update() because of hardware
+ *      limits (only meaningful when Sprite Engine was initialized with #SPR_INIT_FLAG_MULTIPLEX).
+ */
+u16 SPR_getNumDroppedSprite();
+/**
+ *  \brief
+ *      Returns TRUE if frames alternative cutting is currently used (see #SPR_INIT_FLAG_ALT_CUTTING).
+ */
+bool SPR_isAltCuttingActive();
 /**
  *  \brief
  *      Defragment allocated VRAM for sprites, that can help when sprite allocation fail (SPR_addSprite(..) or SPR_addSpriteEx(..) return <i>NULL</i>).
  */
 void SPR_defragVRAM();
+/**
+ *  \brief
+ *      Incremental version of #SPR_defragVRAM(), move at most the given number of tiles toward the start of the sprite VRAM region.
+ *
+ *  \param maxTile
+ *      Maximum number of tile to move for this step (a block larger than this value is never moved).
+ *  \return
+ *      Number of tile moved, 0 when sprite VRAM is fully compacted or when next block to move is larger than <i>maxTile</i>.
+ *
+ *  Tile data is moved using a VRAM DMA copy queued in the critical DMA lane, so it's done on next VBlank just before the
+ *  sprite table update and before other tiles uploads.<br>
+ *  Sprite tile indexes are updated through the sprite table update done by #SPR_update(), so this method should be called
+ *  before #SPR_update() to make the change effective on frame boundary.
+ *
+ *  \see SPR_setAutoDefragVRAM(..)
+ */
+u16 SPR_defragVRAMStep(u16 maxTile);
+/**
+ *  \brief
+ *      Enable automatic incremental VRAM defragmentation in #SPR_update().
+ *
+ *  \param threshold
+ *      Incremental defragmentation is done when largest free block of sprite VRAM (see #VRAM_getLargestFreeBlock(..))
+ *      is below this value (in tile). Use 0 to disable automatic defragmentation (default).
+ *  \param maxTilePerFrame
+ *      Maximum number of tile moved per #SPR_update() call (should be at least the size of the largest sprite VRAM block
+ *      as larger blocks are never moved).
+ *
+ *  \see SPR_defragVRAMStep(..)
+ */
+void SPR_setAutoDefragVRAM(u16 threshold, u16 maxTilePerFrame);
 /**
  *  \brief
  *      Load all frames of SpriteDefinition (using DMA) at specified VRAM tile index and return the indexes table.<br>
@@ -656,6 +879,21 @@ bool SPR_setDefinition(Sprite* sprite, const SpriteDefinition* spriteDef);
  *      Y position
  */
 void SPR_setPosition(Sprite* sprite, s16 x, s16 y);
+/**
+ *  \brief
+ *      Set position of several sprites at once (see #SPR_setPosition(..)).
+ *
+ *  \param sprites
+ *      Sprites to set position for
+ *  \param positions
+ *      Array of sprite position (x, y), one per sprite
+ *  \param num
+ *      Number of sprite
+ *
+ *  Visibility of moved sprites is computed once in next #SPR_update() call.<br>
+ *  NULL entries are ignored.
+ */
+void SPR_setPositions(Sprite** sprites, const Vect2D_s16* positions, u16 num);
 /**
  *  \brief
  *      Set sprite Horizontal Flip attribut.
@@ -706,7 +944,8 @@ void SPR_setPriorityAttribut(Sprite* sprite, u16 value);
  *      The depth value (SPR_MIN_DEPTH to set always on top)
  *
  *  Sprite having lower depth are display in front of sprite with higher depth.<br>
- *  The sprite is *immediately* sorted when its depth value is changed.
+ *  The sprite is *immediately* sorted when its depth value is changed, unless the Sprite Engine
+ *  was initialized with #SPR_INIT_FLAG_DEFERRED_SORT in which case sorting is done on next #SPR_update() call.
  */
 void SPR_setDepth(Sprite* sprite, s16 value);
 /**
@@ -816,6 +1055,39 @@ void SPR_setAutoTileUpload(Sprite* sprite, bool value);
  *  \see #SPR_FLAG_DISABLE_DELAYED_FRAME_UPDATE
  */
 void SPR_setDelayedFrameUpdate(Sprite* sprite, bool value);
+/**
+ *  \brief
+ *      Set the global budget (in bytes) for sprite tiles upload per #SPR_update() call.
+ *
+ *  \param value
+ *      Maximum amount of sprite tiles data (in bytes) uploaded by frame updates between 2 #SPR_update() calls.<br>
+ *      Use 0 to disable the budget (default), only DMA capacity is then considered.
+ *
+ *  Sprites exceeding the budget keep their previous frame and their frame update is done first on next
+ *  #SPR_update() call (oldest deferred first). At least one frame update is always allowed per update.<br>
+ *  Sprites with delayed frame update disabled (see #SPR_setDelayedFrameUpdate(..)) ignore the budget.
+ *
+ *  \see SPR_getNumDeferredFrameUpdate()
+ */
+void SPR_setTileUploadBudget(u16 value);
+/**
+ *  \brief
+ *      Returns the global sprite tiles upload budget in bytes (0 = no budget).
+ *
+ *  \see SPR_setTileUploadBudget(..)
+ */
+u16 SPR_getTileUploadBudget();
+/**
+ *  \brief
+ *      Returns the number of frame update which has been deferred (tiles upload budget or DMA capacity exceeded)
+ *      during last #SPR_update() call.
+ */
+u16 SPR_getNumDeferredFrameUpdate();
+/**
+ *  \brief
+ *      Returns the total number of deferred frame update since Sprite Engine initialization (or last #SPR_reset() call).
+ */
+u32 SPR_getTotalDeferredFrameUpdate();
 /**
  *  \brief
  *      Set the frame change event callback for this sprite.
@@ -847,6 +1119,27 @@ void SPR_setFrameChangeCallback(Sprite* sprite, FrameChangeCallback* callback);
  *      SpriteVisibility.AUTO_SLOW     = visibility is automatically computed from sprite position (per hardware sprite visibility)<br>
  */
 void SPR_setVisibility(Sprite* sprite, SpriteVisibility value);
+/**
+ *  \brief
+ *      Set the far culling margin (in pixel) for sprites using automatic visibility.
+ *
+ *  \param value
+ *      Distance from screen border above which a sprite is considered as far.<br>
+ *      Use 0 to disable far culling (default).
+ *
+ *  When far culling is enabled, sprites are classified (using their current or pending frame size) when added, moved
+ *  with #SPR_setPosition(..) or when the margin is changed, and a far sprite is hidden without any visibility computation. It is then ignored by #SPR_update() (animation is paused) until
+ *  it comes back near the screen, so moving far sprites costs almost nothing.<br>
+ *  In multiplexing mode (see #SPR_INIT_FLAG_MULTIPLEX) far sprites don't use any hardware sprite.
+ */
+void SPR_setCullingMargin(u16 value);
+/**
+ *  \brief
+ *      Returns the far culling margin in pixel (0 = far culling disabled).
+ *
+ *  \see SPR_setCullingMargin(..)
+ */
+u16 SPR_getCullingMargin();
 /**
  *  \deprecated Use #SPR_setVisibility(..) method instead.
  */
@@ -897,11 +1190,28 @@ void SPR_clear();
  *      Update and display the active list of sprite.
  *
  *  This actually updates all internal active sprites states and prepare the sprite list
- *  cache to send it to the hardware (VDP) at Vint.
+ *  cache to send it to the hardware (VDP) at Vint.<br>
+ *  Only the modified part of the sprite list cache is sent (see #SPR_setVDPSpritesDirty(..)).<br>
+ *  Sprites are processed in allocation order (not in depth order): when DMA capacity or tiles upload budget is exceeded,
+ *  frame update deferral, tiles upload order and frame change callbacks (see #SPR_setFrameChangeCallback(..)) follow this
+ *  order. Deferred frame updates are always processed first on next update (oldest first).
  *
  *  \see #SPR_addSprite(..)
  */
 void SPR_update();
+/**
+ *  \brief
+ *      Mark VDP sprites as modified so they are sent to the VDP on next #SPR_update() call.
+ *
+ *  \param index
+ *      first VDP sprite index
+ *  \param num
+ *      number of VDP sprite (0 = whole VDP sprite table)
+ *
+ *  #SPR_update() only sends the part of the sprite list cache (vdpSpriteCache) modified by the Sprite Engine,
+ *  direct changes in vdpSpriteCache (manually allocated VDP sprites for instance) have to be declared with this method.
+ */
+void SPR_setVDPSpritesDirty(u16 index, u16 num);
 
 /**
  *  \brief
@@ -913,6 +1223,38 @@ void SPR_logProfil();
  *      Log the sprites informations (when enabled) in the KMod message window.
  */
 void SPR_logSprites();
+/**
+ *  \brief
+ *      Enable/disable runtime statistics recording (disabled by default).
+ *
+ *  \param value
+ *      TRUE to record statistics of each #SPR_update() call in a #SPR_STATS_HISTORY entries history.
+ *
+ *  Unlike SPR_PROFIL profiling this doesn't require to rebuild the library, cost is a few sub tick reads per #SPR_update().
+ *
+ *  \see SPR_getFrameStats(..)
+ *  \see SPR_logFrameStats(..)
+ */
+void SPR_setStatsEnabled(bool value);
+/**
+ *  \brief
+ *      Returns runtime statistics of a previous #SPR_update() call.
+ *
+ *  \param age
+ *      0 for last #SPR_update() call, 1 for the one before... up to #SPR_STATS_HISTORY - 1
+ *  \return
+ *      statistics of wanted #SPR_update() call (or NULL if not available).
+ *
+ *  \see SPR_setStatsEnabled(..)
+ */
+const SpriteFrameStats* SPR_getFrameStats(u16 age);
+/**
+ *  \brief
+ *      Log runtime statistics of the last <i>num</i> #SPR_update() calls in the KMod message window (one line per frame, oldest first).
+ *
+ *  \see SPR_setStatsEnabled(..)
+ */
+void SPR_logFrameStats(u16 num);
 
 
 #endif // _SPRITE_ENG_H_
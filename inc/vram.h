@@ -265,6 +265,26 @@ s16 VRAM_alloc(VRAMRegion *region, u16 size);
  *  \see VRAM_alloc(..)
  */
 void VRAM_free(VRAMRegion *region, u16 index);
+/**
+ *  \brief
+ *      Do a single compaction step in the given VRAM region.
+ *
+ *  \param region
+ *      VRAM region
+ *  \param maxSize
+ *      Maximum size (in tile) of the block we accept to move.
+ *  \param from
+ *      Receive the tile index of the block to move.
+ *  \param to
+ *      Receive the new tile index of the block (start of the free area preceding it).
+ *  \return
+ *      the size (in tile) of the block to move, 0 if the region is already compacted.<br>
+ *      If returned size is larger than <i>maxSize</i> the block is not moved.
+ *
+ *  Find the first allocated block located after a free area and move it at start of this free area.<br>
+ *  Only the allocation information is modified, it's up to the caller to move tile data and update tile indexes.
+ */
+u16 VRAM_compactStep(VRAMRegion *region, u16 maxSize, u16 *from, u16 *to);
 
 
 #endif // _VRAM_H_
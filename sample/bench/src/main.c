@@ -5,7 +5,7 @@
 
 #define SGDK_BENCHMARK      "SGDK benchmark v1.3"
 
-#define MAX_TEST            9
+#define MAX_TEST            10
 #define MAX_SUBTEST         16
 
 
@@ -21,6 +21,7 @@ u16 scores[MAX_TEST];
 u16 executeMemsetTest(u16 *scores);
 u16 executeMemcpyTest(u16 *scores);
 u16 executeMemAllocTest(u16 *scores);
+u16 executeMemPoolTest(u16 *scores);
 u16 executeVRamAllocTest(u16 *scores);
 u16 executeMathsBasicTest(u16 *scores);
 u16 executeMathsAdvTest(u16 *scores);
@@ -73,6 +74,13 @@ int main()
         globalScore += score;
         testNum++;
 
+        preTest("Memory pool test", testNum);
+        score = executeMemPoolTest(detailledScores[testNum]);
+        scores[testNum] = score;
+        postTest("Memory pool test", score, testNum);
+        globalScore += score;
+        testNum++;
+
         preTest("VRAM alloc/release test", testNum);
         score = executeVRamAllocTest(detailledScores[testNum]);
         scores[testNum] = score;
@@ -147,9 +155,9 @@ static void showIntroScreen()
     VDP_drawText(str, 0, 4);
     sprintf(str, "  Stack size          %05u bytes", (u16) STACK_SIZE);
     VDP_drawText(str, 0, 5);
-    sprintf(str, "  DMA queue & buffer  %05u bytes", DMA_getBufferSize() + (u16) (DMA_getMaxQueueSize() * sizeof(DMAOpInfo)));
+    sprintf(str, "  DMA queue & buffer  %05u bytes", DMA_getBufferSize() + (u16) ((DMA_QUEUE_SIZE_CRITICAL + DMA_getMaxQueueSize() + DMA_getBackgroundQueueSize()) * sizeof(DMAOpInfo)));
     VDP_drawText(str, 0, 6);
-    sprintf(str, "  Memory manager      %05u bytes", (65536 - MEM_getFree()) - (((u16) ((u32)&_bend) & 0xFFFF) + STACK_SIZE + DMA_getBufferSize() + (u16) (DMA_getMaxQueueSize() * sizeof(DMAOpInfo))));
+    sprintf(str, "  Memory manager      %05u bytes", (65536 - MEM_getFree()) - (((u16) ((u32)&_bend) & 0xFFFF) + STACK_SIZE + DMA_getBufferSize() + (u16) ((DMA_QUEUE_SIZE_CRITICAL + DMA_getMaxQueueSize() + DMA_getBackgroundQueueSize()) * sizeof(DMAOpInfo))));
     VDP_drawText(str, 0, 7);
     sprintf(str, "Free VRAM              %04d tiles", TILE_USERMAXINDEX);
     VDP_drawText(str, 0, 9);
@@ -250,6 +258,9 @@ static void postResume(u32 score)
     sprintf(str, "Memory alloc/release score = %d", scores[testNum++]);
     VDP_drawText(str, 4, y);
     y += 2;
+    sprintf(str, "Memory pool score = %d", scores[testNum++]);
+    VDP_drawText(str, 4, y);
+    y += 2;
     sprintf(str, "VRAM alloc/release score = %d", scores[testNum++]);
     VDP_drawText(str, 4, y);
     y += 2;
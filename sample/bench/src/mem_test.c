@@ -7,6 +7,8 @@
 // forward
 static u16 doAlloc(u16 num, u16 size, void **allocs, u16 verif);
 static u16 doRelease(u16 num, u16 size, void **allocs, u16 verif);
+static u16 doPoolAlloc(MemPool *pool, u16 num, void **allocs, u16 verif);
+static u16 doPoolRelease(MemPool *pool, u16 num, void **allocs, u16 verif);
 static u16 doVRamAlloc(VRAMRegion *region, u16 num, u16 size, s16 *allocs, u16 verif);
 static u16 doVRamRelease(VRAMRegion *region, u16 num, u16 size, s16 *allocs, u16 verif);
 static u32 displayResult(u32 bytes, fix32 time, u16 y);
@@ -393,6 +395,118 @@ u16 executeMemAllocTest(u16 *scores)
     return globalScore;
 }
 
+u16 executeMemPoolTest(u16 *scores)
+{
+    fix32 start;
+    fix32 end;
+    fix32 time;
+    u16 i, j, y;
+    void **allocs;
+    void **live;
+    MemPool pool;
+    u16 *score;
+    u16 globalScore;
+
+    KLog_U2("Pool - Mem free before: ", MEM_getFree(), "   Mem allocated: ", MEM_getAllocated());
+
+    allocs = MEM_alloc(1000 * sizeof(void*));
+    MEM_createPool(&pool, 16, 1000);
+
+    score = scores;
+    globalScore = 0;
+
+    y = 0;
+    VDP_drawText("Executing mem pool tests...", 1, y++);
+    y++;
+
+    if (!doPoolAlloc(&pool, 1000, allocs, TRUE))
+        VDP_drawText("Error while allocating...", 2, y++);
+    if (!doPoolRelease(&pool, 1000, allocs, TRUE))
+        VDP_drawText("Error while releasing...", 2, y++);
+
+    VDP_drawText("50000 allocations of 16 bytes", 2, y++);
+    i = 50;
+    time = FIX32(0);
+    while(i--)
+    {
+        // count time only for allocation
+        start = getTimeAsFix32(FALSE);
+        doPoolAlloc(&pool, 1000, allocs, FALSE);
+        end = getTimeAsFix32(FALSE);
+        time += end - start;
+        doPoolRelease(&pool, 1000, allocs, FALSE);
+    }
+    *score = displayResultAlloc(50000, time, y++);
+    globalScore += *score++;
+    y++;
+
+    VDP_drawText("100000 releases of 16 bytes", 2, y++);
+    i = 100;
+    time = FIX32(0);
+    while(i--)
+    {
+        doPoolAlloc(&pool, 1000, allocs, FALSE);
+        // count time only for release
+        start = getTimeAsFix32(FALSE);
+        doPoolRelease(&pool, 1000, allocs, FALSE);
+        end = getTimeAsFix32(FALSE);
+        time += end - start;
+    }
+    *score = displayResultAlloc(100000, time, y++);
+    globalScore += *score++;
+    y++;
+
+    VDP_drawText("50000 alloc/release of 16 bytes", 2, y++);
+    i = 500;
+    start = getTimeAsFix32(FALSE);
+    while(i--)
+    {
+        doPoolAlloc(&pool, 100, allocs, FALSE);
+        doPoolRelease(&pool, 100, allocs, FALSE);
+    }
+    end = getTimeAsFix32(FALSE);
+    *score = displayResultAlloc(50000, end - start, y++);
+    globalScore += *score++;
+    y++;
+
+    // bullets like usage: iterate live objects and release 1 on 4
+    VDP_drawText("50000 alloc/iterate/release", 2, y++);
+    i = 100;
+    start = getTimeAsFix32(FALSE);
+    while(i--)
+    {
+        doPoolAlloc(&pool, 500, allocs, FALSE);
+
+        live = MEM_getPoolLive(&pool);
+        // iterate from end as release moves last live object in released slot
+        j = MEM_getPoolNumLive(&pool);
+        while(j--)
+        {
+            if ((j & 3) == 0) MEM_freePool(&pool, live[j]);
+        }
+
+        MEM_clearPool(&pool);
+    }
+    end = getTimeAsFix32(FALSE);
+    *score = displayResultAlloc(50000, end - start, y++);
+    globalScore += *score++;
+    y++;
+
+    if (MEM_getPoolPeak(&pool) != 500)
+        VDP_drawText("Error in pool peak...", 2, y++);
+
+    waitMs(5000);
+    VDP_clearPlane(BG_A, TRUE);
+
+    MEM_releasePool(&pool);
+    MEM_free(allocs);
+    MEM_pack();
+
+    KLog_U2("Pool - Mem free after: ", MEM_getFree(), "   Mem allocated: ", MEM_getAllocated());
+
+    return globalScore;
+}
+
 u16 executeVRamAllocTest(u16 *scores)
 {
     fix32 start;
@@ -704,6 +818,103 @@ static u16 doRelease(u16 num, u16 size, void **allocs, u16 verif)
 }
 
 
+static u16 doPoolAlloc(MemPool *pool, u16 num, void **allocs, u16 verif)
+{
+    void **tab;
+    u16 i;
+    u16 free = 0;
+
+    if (verif) free = MEM_getPoolFree(pool);
+
+    tab = allocs;
+    i = num;
+    while(i > 10)
+    {
+        *tab++ = MEM_allocPool(pool);
+        *tab++ = MEM_allocPool(pool);
+        *tab++ = MEM_allocPool(pool);
+        *tab++ = MEM_allocPool(pool);
+        *tab++ = MEM_allocPool(pool);
+        *tab++ = MEM_allocPool(pool);
+        *tab++ = MEM_allocPool(pool);
+        *tab++ = MEM_allocPool(pool);
+        *tab++ = MEM_allocPool(pool);
+        *tab++ = MEM_allocPool(pool);
+        i -= 10;
+    }
+    while(i--) *tab++ = MEM_allocPool(pool);
+
+    if (verif)
+    {
+        tab = allocs;
+        i = num;
+        while(i--)
+        {
+            if (*tab++ == NULL)
+            {
+                KDebug_Alert("Error pool alloc - first position:");
+                KDebug_AlertNumber(tab - allocs);
+                break;
+            }
+        }
+
+        // verify allocation was correctly done
+        if ((free - num) != MEM_getPoolFree(pool))
+        {
+            KDebug_Alert("Error pool alloc");
+            KDebug_AlertNumber(free);
+            KDebug_AlertNumber(num);
+            KDebug_AlertNumber(MEM_getPoolFree(pool));
+            return FALSE;
+        }
+    }
+
+    return TRUE;
+}
+
+static u16 doPoolRelease(MemPool *pool, u16 num, void **allocs, u16 verif)
+{
+    void **tab;
+    u16 i;
+    u16 free = 0;
+
+    if (verif) free = MEM_getPoolFree(pool);
+
+    tab = allocs;
+    i = num;
+    while(i > 10)
+    {
+        MEM_freePool(pool, *tab++);
+        MEM_freePool(pool, *tab++);
+        MEM_freePool(pool, *tab++);
+        MEM_freePool(pool, *tab++);
+        MEM_freePool(pool, *tab++);
+        MEM_freePool(pool, *tab++);
+        MEM_freePool(pool, *tab++);
+        MEM_freePool(pool, *tab++);
+        MEM_freePool(pool, *tab++);
+        MEM_freePool(pool, *tab++);
+        i -= 10;
+    }
+    while(i--) MEM_freePool(pool, *tab++);
+
+    if (verif)
+    {
+        // verify release was correctly done
+        if ((free + num) != MEM_getPoolFree(pool))
+        {
+            KDebug_Alert("Error pool release");
+            KDebug_AlertNumber(free);
+            KDebug_AlertNumber(num);
+            KDebug_AlertNumber(MEM_getPoolFree(pool));
+            return FALSE;
+        }
+    }
+
+    return TRUE;
+}
+
+
 static u16 doVRamAlloc(VRAMRegion *region, u16 num, u16 size, s16 *allocs, u16 verif)
 {
     s16 *tab;
@@ -17,6 +17,15 @@ static u16 executePartic(u16 time, u16 numPartic, u16 preloadedTiles, u16 reallo
 static void updateDonut(u16 num, u16 preloadedTiles, u16 time);
 static u16 executeDonut(u16 time, u16 preloadedTiles);
 
+static u16 executeSort(u16 numSpr, u16 numFrame);
+static void executeSortBench();
+static u16 executeUpdate(u16 numSpr, u16 numFrame, u16 move);
+static void executeUpdateBench();
+static u16 checkFarCulling();
+static u16 executeBatch(u16 numSpr, u16 numFrame, u16 batch);
+static u16 removeSpriteEntries(u16 ind, u16 count, u16 num);
+static void executeBatchBench();
+
 static void initPos(u16 num);
 static void updatePos(u16 num);
 static void updateAnim(u16 num);
@@ -40,6 +49,7 @@ static Object objects[MAX_OBJECT];
 static Sprite* sprites[MAX_OBJECT];
 static u16 palette[64];
 static u16 tileIndexes[64];
+static Vect2D_s16 positions[MAX_OBJECT];
 
 // sprites structure
 static Sprite *guySprite;
@@ -486,6 +496,47 @@ u16 executeSpritesTest(u16 *scores)
     *scores = execute(50, 4);
     globalScore += *scores++;
 
+    SYS_disableInts();
+    SPR_reset();
+    SPR_clear();
+    VDP_clearPlane(BG_A, TRUE);
+    VDP_drawText("Depth sort (list vs radix)", 1, 2);
+    SYS_enableInts();
+
+    waitMs(5000);
+    SYS_disableInts();
+    VDP_clearPlane(BG_A, TRUE);
+    SYS_enableInts();
+
+    // execute depth sort bench (informative only, not part of score)
+    executeSortBench();
+
+    SYS_disableInts();
+    VDP_clearPlane(BG_A, TRUE);
+    VDP_drawText("SPR_update cost (idle vs moving)", 1, 2);
+    SYS_enableInts();
+
+    waitMs(5000);
+    SYS_disableInts();
+    VDP_clearPlane(BG_A, TRUE);
+    SYS_enableInts();
+
+    // execute sprite update bench (informative only, not part of score)
+    executeUpdateBench();
+
+    SYS_disableInts();
+    VDP_clearPlane(BG_A, TRUE);
+    VDP_drawText("Particle API (per call vs batch)", 1, 2);
+    SYS_enableInts();
+
+    waitMs(5000);
+    SYS_disableInts();
+    VDP_clearPlane(BG_A, TRUE);
+    SYS_enableInts();
+
+    // execute batch API bench (informative only, not part of score)
+    executeBatchBench();
+
     SYS_disableInts();
     SPR_reset();
     SPR_clear();
@@ -795,6 +846,326 @@ static u16 executeDonut(u16 time, u16 preloadedTiles)
     return score;
 }
 
+static u16 executeSort(u16 numSpr, u16 numFrame)
+{
+    u32 total;
+    u16 frame;
+    u16 i;
+
+    // initialize sprites
+    for(i = 0; i < numSpr; i++)
+        sprites[i] = SPR_addSprite(&flare_small, (i & 15) * 18, 24 + ((i >> 4) * 20), TILE_ATTR(PAL1, FALSE, FALSE, FALSE));
+
+    SPR_update();
+    SYS_doVBlankProcess();
+
+    total = 0;
+    frame = numFrame;
+    while(frame--)
+    {
+        const u32 start = getSubTick();
+
+        // re-Z all sprites (same sequence for both sort modes)
+        for(i = 0; i < numSpr; i++)
+            SPR_setDepth(sprites[i], ((i * 37) + (frame * 13)) & 0xFF);
+        // update sprites
+        SPR_update();
+
+        total += getSubTick() - start;
+
+        SYS_doVBlankProcess();
+    }
+
+    SYS_disableInts();
+    SPR_reset();
+    SPR_clear();
+    SYS_enableInts();
+
+    // average sub tick per frame
+    return total / numFrame;
+}
+
+static void executeSortBench()
+{
+    const u16 nums[4] = { 20, 40, 60, 79 };
+    u16 res[2][4];
+    char str[40];
+    u16 mode, i;
+
+    // set palette
+    VDP_setPalette(PAL1, flare_small.palette->data);
+
+    for(mode = 0; mode < 2; mode++)
+    {
+        // re-init sprite engine with wanted sort mode
+        SYS_disableInts();
+        SPR_initEx2(16 * (32 + 16 + 8), mode?SPR_INIT_FLAG_DEFERRED_SORT:0);
+        SYS_enableInts();
+
+        for(i = 0; i < 4; i++)
+            res[mode][i] = executeSort(nums[i], 120);
+    }
+
+    // display results (1 sub tick ~ 100 CPU cycles)
+    SYS_disableInts();
+    VDP_clearPlane(BG_A, TRUE);
+    VDP_drawText("Sub ticks / frame (x100 cycles)", 1, 2);
+    VDP_drawText("Sprites    List    Radix", 1, 4);
+    for(i = 0; i < 4; i++)
+    {
+        sprintf(str, "%2d       %5d    %5d", nums[i], res[0][i], res[1][i]);
+        VDP_drawText(str, 2, 5 + i);
+    }
+    // restore default sort mode for following tests
+    SPR_initEx(16 * (32 + 16 + 8));
+    SYS_enableInts();
+
+    waitMs(5000);
+}
+
+static u16 executeUpdate(u16 numSpr, u16 numFrame, u16 move)
+{
+    u32 total;
+    u16 frame;
+    u16 i;
+
+    // initialize sprites
+    for(i = 0; i < numSpr; i++)
+        sprites[i] = SPR_addSprite(&flare_small, (i & 15) * 18, 24 + ((i >> 4) * 20), TILE_ATTR(PAL1, FALSE, FALSE, FALSE));
+
+    SPR_update();
+    SYS_doVBlankProcess();
+
+    total = 0;
+    frame = numFrame;
+    while(frame--)
+    {
+        // move all sprites (outside measure, we only want SPR_update() cost)
+        if (move)
+        {
+            for(i = 0; i < numSpr; i++)
+                SPR_setPosition(sprites[i], ((i & 15) * 18) + (frame & 7), 24 + ((i >> 4) * 20));
+        }
+
+        const u32 start = getSubTick();
+        // update sprites
+        SPR_update();
+        total += getSubTick() - start;
+
+        SYS_doVBlankProcess();
+    }
+
+    SYS_disableInts();
+    SPR_reset();
+    SPR_clear();
+    SYS_enableInts();
+
+    // average sub tick per frame
+    return total / numFrame;
+}
+
+static void executeUpdateBench()
+{
+    const u16 nums[4] = { 20, 40, 60, 79 };
+    u16 res[2][4];
+    char str[40];
+    u16 i;
+
+    // set palette
+    VDP_setPalette(PAL1, flare_small.palette->data);
+
+    for(i = 0; i < 4; i++)
+    {
+        res[0][i] = executeUpdate(nums[i], 120, FALSE);
+        res[1][i] = executeUpdate(nums[i], 120, TRUE);
+    }
+
+    // display results (1 sub tick ~ 100 CPU cycles)
+    SYS_disableInts();
+    VDP_clearPlane(BG_A, TRUE);
+    VDP_drawText("SPR_update sub ticks / frame", 1, 2);
+    VDP_drawText("Sprites    Idle    Moving", 1, 4);
+    for(i = 0; i < 4; i++)
+    {
+        sprintf(str, "%2d       %5d    %5d", nums[i], res[0][i], res[1][i]);
+        VDP_drawText(str, 2, 5 + i);
+    }
+    SYS_enableInts();
+
+    // far culled sprite shouldn't be animated anymore
+    i = checkFarCulling();
+
+    SYS_disableInts();
+    VDP_drawText("Far sprite animation frozen:", 1, 10);
+    VDP_drawText(i?"OK":"FAILED", 30, 10);
+    SYS_enableInts();
+
+    waitMs(5000);
+}
+
+static u16 checkFarCulling()
+{
+    Sprite* spr;
+    s16 frameInd;
+    u16 frame;
+    u16 res;
+
+    // animated sprite moved far outside the screen
+    spr = SPR_addSprite(&donut, 0, 0, TILE_ATTR(PAL1, FALSE, FALSE, FALSE));
+    SPR_setVisibility(spr, AUTO_FAST);
+    SPR_setCullingMargin(64);
+    SPR_setPosition(spr, 1024, 1024);
+    SPR_update();
+    SYS_doVBlankProcess();
+
+    // far sprite is ignored by SPR_update() so its frame shouldn't change
+    frameInd = spr->frameInd;
+    frame = 60;
+    while(frame--)
+    {
+        SPR_update();
+        SYS_doVBlankProcess();
+    }
+    res = (spr->frameInd == frameInd);
+
+    SYS_disableInts();
+    SPR_setCullingMargin(0);
+    SPR_reset();
+    SPR_clear();
+    SYS_enableInts();
+
+    return res;
+}
+
+static u16 executeBatch(u16 numSpr, u16 numFrame, u16 batch)
+{
+    const u16 flag = SPR_FLAG_AUTO_VISIBILITY | SPR_FLAG_AUTO_SPRITE_ALLOC | SPR_FLAG_SHARED_TILES;
+    u32 total;
+    u16 frame;
+    u16 num;
+    u16 rem;
+    u16 i;
+
+    // initial positions
+    for(i = 0; i < numSpr; i++)
+    {
+        positions[i].x = (i & 15) * 18;
+        positions[i].y = 24 + ((i >> 4) * 20);
+    }
+
+    // initialize sprites (only keep successfully added sprites)
+    if (batch) num = SPR_addSprites(sprites, &flare_small, positions, numSpr, TILE_ATTR(PAL1, FALSE, FALSE, FALSE), flag);
+    else
+    {
+        num = 0;
+        for(i = 0; i < numSpr; i++)
+        {
+            Sprite* spr = SPR_addSpriteEx(&flare_small, positions[i].x, positions[i].y, TILE_ATTR(PAL1, FALSE, FALSE, FALSE), 0, flag);
+
+            if (spr) sprites[num++] = spr;
+        }
+    }
+
+    SPR_update();
+    SYS_doVBlankProcess();
+
+    total = 0;
+    frame = numFrame;
+    while(frame--)
+    {
+        // new positions (outside measure)
+        for(i = 0; i < numSpr; i++)
+            positions[i].x = ((i & 15) * 18) + (frame & 7);
+
+        // number of particles to respawn
+        rem = min(num, numSpr >> 2);
+
+        const u32 start = getSubTick();
+
+        // particle pattern: respawn a quarter of particles then move all of them
+        if (batch)
+        {
+            SPR_releaseSprites(sprites, rem);
+            i = SPR_addSprites(sprites, &flare_small, positions, rem, TILE_ATTR(PAL1, FALSE, FALSE, FALSE), flag);
+            // some respawn failed --> remove released entries
+            if (i < rem) num = removeSpriteEntries(i, rem - i, num);
+            SPR_setPositions(sprites, positions, num);
+        }
+        else
+        {
+            u16 added = 0;
+
+            for(i = 0; i < rem; i++)
+            {
+                SPR_releaseSprite(sprites[i]);
+
+                Sprite* spr = SPR_addSpriteEx(&flare_small, positions[i].x, positions[i].y, TILE_ATTR(PAL1, FALSE, FALSE, FALSE), 0, flag);
+
+                if (spr) sprites[added++] = spr;
+            }
+            // some respawn failed --> remove released entries
+            if (added < rem) num = removeSpriteEntries(added, rem - added, num);
+            for(i = 0; i < num; i++)
+                SPR_setPosition(sprites[i], positions[i].x, positions[i].y);
+        }
+        // update sprites
+        SPR_update();
+
+        total += getSubTick() - start;
+
+        SYS_doVBlankProcess();
+    }
+
+    SYS_disableInts();
+    SPR_reset();
+    SPR_clear();
+    SYS_enableInts();
+
+    // average sub tick per frame
+    return total / numFrame;
+}
+
+static u16 removeSpriteEntries(u16 ind, u16 count, u16 num)
+{
+    u16 i;
+
+    for(i = ind; i < (num - count); i++)
+        sprites[i] = sprites[i + count];
+
+    return num - count;
+}
+
+static void executeBatchBench()
+{
+    const u16 nums[4] = { 20, 40, 60, 79 };
+    u16 res[2][4];
+    char str[40];
+    u16 i;
+
+    // set palette
+    VDP_setPalette(PAL1, flare_small.palette->data);
+
+    for(i = 0; i < 4; i++)
+    {
+        res[0][i] = executeBatch(nums[i], 120, FALSE);
+        res[1][i] = executeBatch(nums[i], 120, TRUE);
+    }
+
+    // display results (1 sub tick ~ 100 CPU cycles)
+    SYS_disableInts();
+    VDP_clearPlane(BG_A, TRUE);
+    VDP_drawText("Particle sub ticks / frame", 1, 2);
+    VDP_drawText("Sprites  Per call    Batch", 1, 4);
+    for(i = 0; i < 4; i++)
+    {
+        sprintf(str, "%2d       %5d    %5d", nums[i], res[0][i], res[1][i]);
+        VDP_drawText(str, 2, 5 + i);
+    }
+    SYS_enableInts();
+
+    waitMs(5000);
+}
+
 static void initPos(u16 num)
 {
     Sprite** sprite;
@@ -5,43 +5,179 @@
 #include "sys.h"
 #include "memory.h"
 #include "z80_ctrl.h"
+#include "xgm.h"
+#include "timer.h"
 
 #include "kdebug.h"
 #include "tools.h"
+#include "string.h"
 
 
 //#define DMA_DEBUG
 
 #define DMA_AUTOFLUSH               1
 #define DMA_OVERCAPACITY_IGNORE     2
+#define DMA_AUTOCAPACITY            4
+
+// VRAM fill / copy operation marker (DMA mode bit of register $17 in DMAOpInfo.regAddrHAddrL)
+#define DMA_FILLCOPY_FLAG           0x00800000
+
+// DMA bandwidth (in byte per line) during blanking and active display for H40 and H32 modes
+#define DMA_BLANK_RATE_H40          205
+#define DMA_BLANK_RATE_H32          167
+#define DMA_ACTIVE_RATE_H40         18
+#define DMA_ACTIVE_RATE_H32         16
+// blank lines not available for the DMA queue (V-Int latency and VBlank process before the flush)
+#define DMA_BLANK_LINES_RESERVED    2
+
+// Z80 driver tolerance to main BUS contention (in scanline of continuous DMA) for sample drivers and XGM driver
+#define DMA_BUS_HOLD_LINES_PCM      2
+#define DMA_BUS_HOLD_LINES_XGM      4
+// time given back to the Z80 between 2 DMA windows (in subtick, about 1 scanline)
+#define DMA_BUS_RELEASE_SUBTICK     5
+
+#if (DMA_TRACE != 0)
+// store call site (return address) of DMA queue public methods
+#define TRACE_SITE()                traceSite = (u32) __builtin_return_address(0)
+#else
+#define TRACE_SITE()
+#endif
 
 
 // we don't want to share it
 extern vu16 VBlankProcess;
 
-// DMA queue
+// DMA queue (lanes queues are allocated in a single block)
 DMAOpInfo *dmaQueues = NULL;
 
+// DMA queue lanes
+static DMAOpInfo* laneQueue[DMA_LANE_NUM];
+static u16 laneSize[DMA_LANE_NUM];
+static u16 laneIndex[DMA_LANE_NUM];
+static u16 laneTransferSize[DMA_LANE_NUM];
+
+// last queued transfer of each lane (used to merge contiguous transfers)
+typedef struct
+{
+    u32 from;       // source start address
+    u32 fromEnd;    // source end address (next contiguous source)
+    u16 toEnd;      // destination end address (next contiguous destination)
+    u16 len;        // length (in word)
+    u16 step;
+    u16 location;   // 0xFFFF = no transfer to merge with
+} DMALastOp;
+
+static DMALastOp laneLastOp[DMA_LANE_NUM];
+// number of transfer merged with previous one
+static u32 mergedNum;
+
 // DMA data buffer
 static u16* dataBuffer = NULL;
 static u16* nextDataBuffer;
 
 // DMA queue settings
 static u16 queueSize;
+static u16 bgQueueSize = DMA_QUEUE_SIZE_BACKGROUND;
 static u16 maxTransferPerFrame;
 static u16 flag;
 
 // DMA data buffer settings
 static u16 dataBufferSize;
 
-// current queue index (0 = empty / queueSize = full)
+// multi buffering: number of data buffer (1 = single buffer, no fence), size of each buffer (in word) and buffer being written
+static u16 bufferNum;
+static u16 bufferSegSize;
+static u16 writeBuffer;
+static u16* writeBufferStart;
+static u16* writeBufferEnd;
+// frame fences: number of fenced frames waiting for flush, queue index of each lane at fence (oldest first)
+static u16 fenceNum;
+static u16 fenceIndex[DMA_BUFFER_NUM_MAX - 1][DMA_LANE_NUM];
+// data buffer high-water mark (in word) of current frame and of fenced frames (oldest first)
+static u16 highWater;
+static u16 fenceHighWater[DMA_BUFFER_NUM_MAX - 1];
+// data buffer high-water mark (in word) of last flushed frame and maximum one
+static u16 lastHighWater;
+static u16 maxHighWater;
+
+// number of queued VRAM fill / copy operation (reset when queue is empty)
+static u16 fillCopyNum;
+
+// number of pending transfer (all lanes)
 static u16 queueIndex;
-static u16 queueIndexLimit;
+// size of pending transfers (all lanes)
 static u16 queueTransferSize;
+// over capacity warning already done
+static bool overCapacity;
+// auto capacity: safety margin (in bytes) learned from VBlank overrun
+static u16 autoMargin;
+// size (in bytes) transferred on last flush and capacity it was compared to
+static u16 lastTransferSize;
+static u16 lastCapacity;
+
+// BUS hold limit setting (in bytes, 0 = no limit), limit used by current flush (in word)
+static u16 busHoldLimit;
+static u16 holdLimit;
+// size (in word) of current DMA window and maximum one in current flush, maximum one (in bytes) on last flush
+static u16 holdSize;
+static u16 maxHoldSize;
+static u16 lastBusHold;
+
+#if (DMA_TRACE != 0)
+// call site of each queued transfer (same layout than DMA queue) and call site of current queue method
+static u32* queueSites;
+static u32* laneSite[DMA_LANE_NUM];
+static u32 traceSite;
+// trace ring buffer (NULL = trace disabled), next write index, number of entry and frame (flush) number
+static DMATraceEntry* traceBuffer;
+static u16 traceIndex;
+static u16 traceNum;
+static u16 traceFrame;
+#endif
+
+// HInt slicing: slice size (in bytes, 0 = disabled) and line interval between slices
+static u16 sliceSize;
+static u16 sliceInterval;
+// HInt slicing: in progress, first pending background transfer and size transferred during active display
+static vu16 slicing;
+static vu16 bgHead;
+static vu16 slicedSize;
 
 // do not share (assembly methods)
-void flushQueue(u16 num);
-void flushQueueSafe(u16 num, u16 z80restore);
+void flushQueue(DMAOpInfo* info, u16 num);
+void flushQueueSafe(DMAOpInfo* info, u16 num, u16 z80restore);
+
+static void allocateQueues();
+static void reallocateQueues();
+static u16 getLaneFlushNum(u16 lane, u16 num, u16 capacity);
+static void removeTransfers(const u16* removed);
+static bool checkCapacity(u16 lane);
+static bool queueDma(u8 location, void* from, u16 to, u16 len, u16 step, u16 lane);
+static void* allocateAndQueueDma(u8 location, u16 to, u16 len, u16 step, u16 lane);
+static bool copyAndQueueDma(u8 location, void* from, u16 to, u16 len, u16 step);
+static bool queueVRamFill(u16 to, u16 len, u8 value, u16 step, u16 lane);
+static bool queueVRamCopy(u16 from, u16 to, u16 len, u16 step, u16 lane);
+static bool queueFillCopy(u16 lane, u32 regLen, u32 regAddrMStep, u32 regAddrHAddrL, u32 regCtrlWrite);
+static void flushLane(DMAOpInfo* info, u16 num, u16 z80restore);
+static void doFillCopy(const DMAOpInfo* info);
+static void flushRun(DMAOpInfo* info, u16 num, u16 z80restore);
+static void flushSplit(const DMAOpInfo* info, u16 len, u16 z80restore);
+static void flushDirect(DMAOpInfo* info, u16 num, u16 z80restore);
+static void releaseBus(u16 z80restore);
+static u16 getBusHoldLimit();
+static void setWriteBuffer(u16 index);
+#if (DMA_TRACE != 0)
+static void traceFlush(const u16* num);
+static void traceAdd(const DMATraceEntry* entry);
+static void moveSites(u16 lane, u16 removed);
+#endif
+static u16 getLaneSize(u16 lane, u16 num);
+static u16 getModelCapacity();
+static void compactBackground();
+static void startSlicing();
+static void stopSlicing();
+static void hintSlice();
+static void doSlice(DMAOpInfo* info, u16 z80restore);
 
 
 void DMA_init()
@@ -51,6 +187,8 @@ void DMA_init()
 
 void DMA_initEx(u16 size, u16 capacity, u16 bufferSize)
 {
+    u16 prevTag;
+
     // -1/65535 means no limit
     maxTransferPerFrame = capacity;
     // auto flush is enabled by default
@@ -63,6 +201,18 @@ void DMA_initEx(u16 size, u16 capacity, u16 bufferSize)
         MEM_free(dmaQueues);
         dmaQueues = NULL;
     }
+#if (DMA_TRACE != 0)
+    if (queueSites)
+    {
+        MEM_free(queueSites);
+        queueSites = NULL;
+    }
+    if (traceBuffer)
+    {
+        MEM_free(traceBuffer);
+        traceBuffer = NULL;
+    }
+#endif
     if (dataBuffer)
     {
         MEM_free(dataBuffer);
@@ -72,17 +222,32 @@ void DMA_initEx(u16 size, u16 capacity, u16 bufferSize)
     // try to pack memory free blocks (help to avoid memory fragmentation)
     MEM_pack();
 
-    // define queue size
+    mergedNum = 0;
+    autoMargin = 0;
+    busHoldLimit = DMA_BUS_HOLD_AUTO;
+    lastBusHold = 0;
+    bufferNum = 1;
+    lastHighWater = 0;
+    maxHighWater = 0;
+    lastTransferSize = 0;
+    lastCapacity = 0;
+
+    // define queue size (background lane size is set separately)
     if (size) queueSize = max(DMA_QUEUE_SIZE_MIN, size);
     else queueSize = DMA_QUEUE_SIZE_DEFAULT;
 
+    // DMA allocations tag (heap instrumentation)
+    prevTag = MEM_setTag(MEM_TAG_DMA);
+
     // allocate DMA queue
-    dmaQueues = MEM_alloc(queueSize * sizeof(DMAOpInfo));
+    allocateQueues();
 
     // define DMA data buffer size (in words)
     // this actually clear the DMA queue
     if (bufferSize) DMA_setBufferSize(bufferSize);
     else DMA_setBufferSizeToDefault();
+
+    MEM_setTag(prevTag);
 }
 
 bool DMA_getAutoFlush()
@@ -113,15 +278,62 @@ void DMA_setMaxQueueSize(u16 value)
 {
     queueSize = max(DMA_QUEUE_SIZE_MIN, value);
 
+    reallocateQueues();
+}
+
+u16 DMA_getBackgroundQueueSize()
+{
+    return bgQueueSize;
+}
+
+void DMA_setBackgroundQueueSize(u16 value)
+{
+    bgQueueSize = value;
+
+    reallocateQueues();
+}
+
+static void reallocateQueues()
+{
+    const u16 prevTag = MEM_setTag(MEM_TAG_DMA);
+
     // already allocated ?
     if (dmaQueues) MEM_free(dmaQueues);
+#if (DMA_TRACE != 0)
+    if (queueSites) MEM_free(queueSites);
+#endif
     // allocate DMA queue
-    dmaQueues = MEM_alloc(queueSize * sizeof(DMAOpInfo));
+    allocateQueues();
+
+    MEM_setTag(prevTag);
 
     // reset queue
     DMA_clearQueue();
 }
 
+static void allocateQueues()
+{
+    // critical lane only needs a few entries (sprite table, palettes), normal lane uses the queue size and background
+    // lane has its own (small by default) size
+    laneSize[DMA_LANE_CRITICAL] = DMA_QUEUE_SIZE_CRITICAL;
+    laneSize[DMA_LANE_NORMAL] = queueSize;
+    laneSize[DMA_LANE_BACKGROUND] = bgQueueSize;
+
+    dmaQueues = MEM_alloc((DMA_QUEUE_SIZE_CRITICAL + queueSize + bgQueueSize) * sizeof(DMAOpInfo));
+
+    laneQueue[DMA_LANE_CRITICAL] = dmaQueues;
+    laneQueue[DMA_LANE_NORMAL] = dmaQueues + DMA_QUEUE_SIZE_CRITICAL;
+    laneQueue[DMA_LANE_BACKGROUND] = dmaQueues + DMA_QUEUE_SIZE_CRITICAL + queueSize;
+
+#if (DMA_TRACE != 0)
+    queueSites = MEM_alloc((DMA_QUEUE_SIZE_CRITICAL + queueSize + bgQueueSize) * sizeof(u32));
+
+    laneSite[DMA_LANE_CRITICAL] = queueSites;
+    laneSite[DMA_LANE_NORMAL] = queueSites + DMA_QUEUE_SIZE_CRITICAL;
+    laneSite[DMA_LANE_BACKGROUND] = queueSites + DMA_QUEUE_SIZE_CRITICAL + queueSize;
+#endif
+}
+
 void DMA_setMaxQueueSizeToDefault()
 {
     DMA_setMaxQueueSize(DMA_QUEUE_SIZE_DEFAULT);
@@ -134,10 +346,116 @@ u16 DMA_getMaxTransferSize()
 
 void DMA_setMaxTransferSize(u16 value)
 {
+    // manual capacity --> disable auto capacity
+    flag &= ~DMA_AUTOCAPACITY;
+
     if (value) maxTransferPerFrame = value;
     else maxTransferPerFrame = -1;
 }
 
+bool DMA_getAutoMaxTransferSize()
+{
+    return (flag & DMA_AUTOCAPACITY) ? TRUE : FALSE;
+}
+
+void DMA_setAutoMaxTransferSize(bool value)
+{
+    if (value)
+    {
+        flag |= DMA_AUTOCAPACITY;
+        autoMargin = 0;
+        maxTransferPerFrame = getModelCapacity();
+    }
+    else flag &= ~DMA_AUTOCAPACITY;
+}
+
+u16 DMA_computeTransferCapacity(u16 width, u16 height, bool pal, u16 activeLines)
+{
+    const bool h40 = (width > 256);
+    const u16 totalLines = pal ? 313 : 262;
+    const u16 blankLines = (height < totalLines) ? (totalLines - height) : 0;
+    u32 result;
+
+    // usable blank lines
+    result = (blankLines > DMA_BLANK_LINES_RESERVED) ? (blankLines - DMA_BLANK_LINES_RESERVED) : 0;
+    result *= h40 ? DMA_BLANK_RATE_H40 : DMA_BLANK_RATE_H32;
+    // active display lines used for DMA
+    result += (u32) min(activeLines, height) * (h40 ? DMA_ACTIVE_RATE_H40 : DMA_ACTIVE_RATE_H32);
+
+    // 0xFFFF means no limit
+    return min(result, 0xFFFE);
+}
+
+static u16 getModelCapacity()
+{
+    // display disabled --> the whole frame is blank
+    const u16 result = DMA_computeTransferCapacity(screenWidth, VDP_getEnable() ? screenHeight : 0, IS_PALSYSTEM, 0);
+    const u16 limit = getBusHoldLimit();
+
+    // BUS hold limit ? --> each window is followed by a BUS release gap (about 1 scanline of DMA bandwidth, see releaseBus())
+    if (limit && result)
+        return ((u32) result * limit) / (limit + ((screenWidth > 256) ? DMA_BLANK_RATE_H40 : DMA_BLANK_RATE_H32));
+
+    return result;
+}
+
+u16 DMA_getLastTransferSize()
+{
+    return lastTransferSize;
+}
+
+u16 DMA_getUtilization()
+{
+    if (!lastCapacity) return 0;
+
+    return ((u32) lastTransferSize * 100) / lastCapacity;
+}
+
+u16 DMA_getBusHoldLimit()
+{
+    return busHoldLimit;
+}
+
+void DMA_setBusHoldLimit(u16 value)
+{
+    // keep it even (transfers are done by word) and large enough to not fragment the queue too much
+    if ((value != DMA_BUS_HOLD_AUTO) && value) busHoldLimit = max(DMA_BUS_HOLD_MIN, value & ~1);
+    else busHoldLimit = value;
+}
+
+u16 DMA_getLastBusHold()
+{
+    return lastBusHold;
+}
+
+static u16 getBusHoldLimit()
+{
+    u16 lines;
+
+    if (busHoldLimit != DMA_BUS_HOLD_AUTO) return busHoldLimit;
+
+    switch(Z80_getLoadedDriver())
+    {
+        // sample drivers read ROM continuously
+        case Z80_DRIVER_PCM:
+        case Z80_DRIVER_2ADPCM:
+        case Z80_DRIVER_4PCM:
+            lines = DMA_BUS_HOLD_LINES_PCM;
+            break;
+
+        // XGM driver protects itself from DMA contention, limit only when PCM quality is preferred (see XGM_setForceDelayDMA(..))
+        case Z80_DRIVER_XGM:
+            if (!XGM_getForceDelayDMA()) return 0;
+            lines = DMA_BUS_HOLD_LINES_XGM;
+            break;
+
+        default:
+            return 0;
+    }
+
+    return lines * ((screenWidth > 256) ? DMA_BLANK_RATE_H40 : DMA_BLANK_RATE_H32);
+}
+
 void DMA_setMaxTransferSizeToDefault()
 {
     DMA_setMaxTransferSize(IS_PALSYSTEM ? DMA_TRANSFER_CAPACITY_PAL : DMA_TRANSFER_CAPACITY_NTSC);
@@ -182,30 +500,161 @@ void DMA_setIgnoreOverCapacity(bool value)
 
 void DMA_clearQueue()
 {
+    u16 lane;
+
+    for(lane = 0; lane < DMA_LANE_NUM; lane++)
+    {
+        laneIndex[lane] = 0;
+        laneTransferSize[lane] = 0;
+        laneLastOp[lane].location = 0xFFFF;
+    }
+
     queueIndex = 0;
-    queueIndexLimit = 0;
     queueTransferSize = 0;
+    fillCopyNum = 0;
+    overCapacity = FALSE;
+
+    // background transfers are lost --> stop HInt slicing
+    if (slicing) stopSlicing();
+    bgHead = 0;
+    slicedSize = 0;
+
+    // release fences and reset DMA data buffer pointer
+    fenceNum = 0;
+    highWater = 0;
+    setWriteBuffer(0);
+}
+
+void DMA_setNumBuffer(u16 num)
+{
+    bufferNum = max(1, min(num, DMA_BUFFER_NUM_MAX));
+
+    // reset queue
+    DMA_clearQueue();
+}
 
-    // reset DMA data buffer pointer
-    nextDataBuffer = dataBuffer;
+u16 DMA_getNumBuffer()
+{
+    return bufferNum;
+}
+
+bool DMA_fence()
+{
+    u16 lane;
+
+    // single buffer --> nothing to do
+    if (bufferNum == 1) return TRUE;
+
+    // all data buffers are used by fenced frames
+    if (fenceNum >= (bufferNum - 1))
+    {
+#if (LIB_LOG_LEVEL >= LOG_LEVEL_WARNING)
+        KLog_U1("DMA_fence() failed: no free data buffer, fenced frames waiting for flush = ", fenceNum);
+#endif
+
+        return FALSE;
+    }
+
+    // flush can happen on interrupt
+    SYS_disableInts();
+
+    // store queue position of each lane (transfers of this frame) and data buffer high-water mark
+    for(lane = 0; lane < DMA_LANE_NUM; lane++)
+    {
+        fenceIndex[fenceNum][lane] = laneIndex[lane];
+        // next frame transfers can't be merged with this frame transfers
+        laneLastOp[lane].location = 0xFFFF;
+    }
+    fenceHighWater[fenceNum] = highWater;
+    fenceNum++;
 
+    // next frame uses next data buffer
+    highWater = 0;
+    setWriteBuffer((writeBuffer + 1 == bufferNum) ? 0 : (writeBuffer + 1));
+
+    SYS_enableInts();
+
+    return TRUE;
+}
+
+u16 DMA_getNumFence()
+{
+    return fenceNum;
+}
+
+u16 DMA_getBufferHighWater()
+{
+    return lastHighWater * 2;
+}
+
+u16 DMA_getBufferMaxHighWater()
+{
+    return maxHighWater * 2;
+}
+
+static void setWriteBuffer(u16 index)
+{
+    bufferSegSize = dataBufferSize / bufferNum;
+    writeBuffer = index;
+    writeBufferStart = dataBuffer + (index * bufferSegSize);
+    writeBufferEnd = writeBufferStart + bufferSegSize;
+    nextDataBuffer = writeBufferStart;
 }
 
 void DMA_flushQueue()
 {
-    u16 i;
+    u16 num[DMA_LANE_NUM];
+    u16 count[DMA_LANE_NUM];
+    u16 size[DMA_LANE_NUM];
+    u16 capacity;
+    u16 lane;
     u8 autoInc;
+    bool inVBlank;
 
-    // default
-    i = queueIndex;
+    // auto capacity ? --> compute it from current display mode and learned margin
+    if (flag & DMA_AUTOCAPACITY)
+    {
+        const u16 model = getModelCapacity();
+
+        maxTransferPerFrame = (model > (autoMargin + DMA_BUFFER_SIZE_MIN)) ? (model - autoMargin) : DMA_BUFFER_SIZE_MIN;
+    }
+
+    inVBlank = GET_VDPSTATUS(VDP_VBLANK_FLAG) ? TRUE : FALSE;
+
+    // HInt slicing in progress ? --> stop it and remove background transfers done during active display
+    if (slicing) stopSlicing();
+    compactBackground();
+
+    // get transfers to flush: all queued transfers or transfers of the oldest fenced frame
+    for(lane = 0; lane < DMA_LANE_NUM; lane++)
+    {
+        if (fenceNum)
+        {
+            count[lane] = fenceIndex[0][lane];
+            size[lane] = getLaneSize(lane, count[lane]);
+        }
+        else
+        {
+            count[lane] = laneIndex[lane];
+            size[lane] = laneTransferSize[lane];
+        }
+    }
+
+    // critical transfers are always done
+    num[DMA_LANE_CRITICAL] = count[DMA_LANE_CRITICAL];
+    num[DMA_LANE_NORMAL] = count[DMA_LANE_NORMAL];
+    // remaining capacity after critical transfers
+    capacity = maxTransferPerFrame;
+    if (size[DMA_LANE_CRITICAL] < capacity) capacity -= size[DMA_LANE_CRITICAL];
+    else capacity = 0;
 
     // limit reached ?
-    if (queueIndexLimit)
+    if (size[DMA_LANE_NORMAL] > capacity)
     {
         // we choose to ignore over capacity transfers ?
         if (flag & DMA_OVERCAPACITY_IGNORE)
         {
-            i = queueIndexLimit;
+            num[DMA_LANE_NORMAL] = getLaneFlushNum(DMA_LANE_NORMAL, count[DMA_LANE_NORMAL], capacity);
 
 #if (LIB_LOG_LEVEL >= LOG_LEVEL_WARNING)
             KLog_U2_("DMA_flushQueue(..) warning: transfer size is above ", maxTransferPerFrame, " bytes (", queueTransferSize, "), some transfers are ignored.");
@@ -214,10 +663,23 @@ void DMA_flushQueue()
 #if (LIB_LOG_LEVEL >= LOG_LEVEL_WARNING)
         else KLog_U2_("DMA_flushQueue(..) warning: transfer size is above ", maxTransferPerFrame, " bytes (", queueTransferSize, ").");
 #endif
+
+        capacity = 0;
+    }
+    else capacity -= size[DMA_LANE_NORMAL];
+
+    // background transfers only use the remaining capacity (others are carried over to next flush)
+    if (size[DMA_LANE_BACKGROUND] > capacity)
+    {
+        num[DMA_LANE_BACKGROUND] = getLaneFlushNum(DMA_LANE_BACKGROUND, count[DMA_LANE_BACKGROUND], capacity);
+
+        // always make progress when there is no other transfer
+        if (!num[DMA_LANE_BACKGROUND] && !num[DMA_LANE_CRITICAL] && !num[DMA_LANE_NORMAL]) num[DMA_LANE_BACKGROUND] = 1;
     }
+    else num[DMA_LANE_BACKGROUND] = count[DMA_LANE_BACKGROUND];
 
 #ifdef DMA_DEBUG
-    KLog_U3("DMA_flushQueue: queueIndexLimit=", queueIndexLimit, " queueIndex=", queueIndex, " i=", i);
+    KLog_U4("DMA_flushQueue: queueIndex=", queueIndex, " critical=", num[DMA_LANE_CRITICAL], " normal=", num[DMA_LANE_NORMAL], " background=", num[DMA_LANE_BACKGROUND]);
 #endif
 
     // wait for DMA FILL / COPY operation to complete (otherwise we can corrupt VDP)
@@ -228,21 +690,33 @@ void DMA_flushQueue()
 #if (DMA_DISABLED != 0)
     // DMA disabled --> replace with software copy
 
-    DMAOpInfo *info = dmaQueues;
-
-    while(i--)
+    for(lane = 0; lane < DMA_LANE_NUM; lane++)
     {
-        u16 len = (info->regLen & 0xFF) | ((info->regLen & 0xFF0000) >> 8);
-        s16 step = info->regAddrMStep & 0xFF;
-        u32 from = ((info->regAddrMStep & 0xFF0000) >> 7) | ((info->regAddrHAddrL & 0x7F00FF) << 1);
-        // replace DMA command by WRITE command
-        u32 cmd = info->regCtrlWrite & ~0x80;
+        DMAOpInfo *info = laneQueue[lane];
+        u16 i = num[lane];
 
-        // software copy
-        DMA_doSoftwareCopyDirect(cmd, from, len, step);
-
-        // next
-        info++;
+        while(i--)
+        {
+            // VRAM fill / copy operation --> use VDP
+            if (info->regAddrHAddrL & DMA_FILLCOPY_FLAG)
+            {
+                doFillCopy(info);
+                info++;
+                continue;
+            }
+
+            u16 len = (info->regLen & 0xFF) | ((info->regLen & 0xFF0000) >> 8);
+            s16 step = info->regAddrMStep & 0xFF;
+            u32 from = ((info->regAddrMStep & 0xFF0000) >> 7) | ((info->regAddrHAddrL & 0x7F00FF) << 1);
+            // replace DMA command by WRITE command
+            u32 cmd = info->regCtrlWrite & ~0x80;
+
+            // software copy
+            DMA_doSoftwareCopyDirect(cmd, from, len, step);
+
+            // next
+            info++;
+        }
     }
 #else
     u16 z80restore;
@@ -251,136 +725,768 @@ void DMA_flushQueue()
     if (Z80_isBusTaken()) z80restore = 0x0100;
     else z80restore = 0x0000;
 
+    // Z80 can access main BUS ? --> split DMA in windows of limited size to give it back regularly
+    holdLimit = z80restore ? 0 : (getBusHoldLimit() >> 1);
+    holdSize = 0;
+    maxHoldSize = 0;
+
 #if (HALT_Z80_ON_DMA != 0)
     vu16 *pw = (vu16*) Z80_HALT_PORT;
 
     // disable Z80 before processing DMA
     *pw = 0x0100;
 
-    flushQueue(i);
+    // lanes are flushed by priority order
+    for(lane = 0; lane < DMA_LANE_NUM; lane++)
+        if (num[lane]) flushLane(laneQueue[lane], num[lane], z80restore);
 
     // re-enable Z80 after all DMA (safer method)
     *pw = z80restore;
 #else
-    flushQueueSafe(i, z80restore);
+    // lanes are flushed by priority order
+    for(lane = 0; lane < DMA_LANE_NUM; lane++)
+        if (num[lane]) flushLane(laneQueue[lane], num[lane], z80restore);
 #endif
 
 #endif  // DMA_DISABLED
 
-    // can clear the queue now
-    DMA_clearQueue();
-    // restore autoInc
-    VDP_setAutoInc(autoInc);
-}
+    // last VRAM fill / copy operation should be completed before we modify autoInc
+    if (fillCopyNum) VDP_waitDMACompletion();
 
-//static void flushQueue(u16 num)
-//{
-//    u32 *info = (u32*) dmaQueues;
-//    vu32 *pl = (vu32*) GFX_CTRL_PORT;
-//    u16 i = num;
-//
-//    // flush DMA queue
-//    while(i--)
-//    {
-//        *pl = *info++;  // regLen = 0x94000x9300 | (len | (len << 8) & 0xFF00FF)
-//        *pl = *info++;  // regAddrMStep = 0x96008F00 | ((from << 7) & 0xFF0000) | step
-//        *pl = *info++;  // regAddrHAddrL = 0x97009500 | ((from >> 1) & 0x7F00FF)
-//        *pl = *info++;  // regCtrlWrite =  GFX_DMA_xxx_ADDR(to)
-//    }
-//}
-//
-//static void flushQueueSafe(u16 num, u16 z80restore)
-//{
-//    // z80 BUSREQ off state
-//    const u16 z80off = 0x0100;
-//    const u16 z80on = z80restore;
-//
-//    u32 *info = (u32*) dmaQueues;
-//    vu32 *pl = (vu32*) GFX_CTRL_PORT;
-//    vu16 *pw = (vu16*) Z80_HALT_PORT;
-//    u16 i = num;
-//
-//    // flush DMA queue
-//    while(i--)
-//    {
-//        *pl = *info++;  // regLen = 0x94000x9300 | (len | (len << 8) & 0xFF00FF)
-//        *pl = *info++;  // regAddrMStep = 0x96008F00 | ((from << 7) & 0xFF0000) | step
-//        *pl = *info++;  // regAddrHAddrL = 0x97009500 | ((from >> 1) & 0x7F00FF)
-//
-//        // DISABLE and RE-ENABLE Z80 immediately
-//        // This allow to avoid DMA failure on some MD
-//        // when Z80 try to access 68k BUS at same time the DMA starts.
-//        // BUS arbitrer lantecy will disable Z80 for a very small amont of time
-//        // when DMA start, avoiding that situation to happen.
-//        *pw = z80off;
-//        *pw = z80on;
-//
-//        // then trigger DMA
-//        *pl = *info++;  // regCtrlWrite =  GFX_DMA_xxx_ADDR(to)
-//    }
-//}
+    // store transferred size for utilization report
+    lastTransferSize = size[DMA_LANE_CRITICAL];
+    if (num[DMA_LANE_NORMAL] != count[DMA_LANE_NORMAL]) lastTransferSize += getLaneSize(DMA_LANE_NORMAL, num[DMA_LANE_NORMAL]);
+    else lastTransferSize += size[DMA_LANE_NORMAL];
+    if (num[DMA_LANE_BACKGROUND] != count[DMA_LANE_BACKGROUND]) lastTransferSize += getLaneSize(DMA_LANE_BACKGROUND, num[DMA_LANE_BACKGROUND]);
+    else lastTransferSize += size[DMA_LANE_BACKGROUND];
+    lastCapacity = ((s16) maxTransferPerFrame == -1) ? getModelCapacity() : maxTransferPerFrame;
 
-u16 DMA_getQueueSize()
-{
-    return queueIndex;
-}
+#if (DMA_DISABLED == 0)
+    // longest continuous main BUS hold (all transfers are done at once without limit)
+    if (holdLimit) lastBusHold = max(holdSize, maxHoldSize) << 1;
+    else
+#endif  // DMA_DISABLED
+        lastBusHold = lastTransferSize;
 
-u16 DMA_getQueueTransferSize()
-{
-    return queueTransferSize;
-}
+#if (DMA_TRACE != 0)
+    if (traceBuffer) traceFlush(num);
+#endif
 
-bool DMA_transfer(TransferMethod tm, u8 location, void* from, u16 to, u16 len, u16 step)
-{
-    switch(tm)
+    // auto capacity and flush started in VBlank ? --> adjust margin
+    if ((flag & DMA_AUTOCAPACITY) && inVBlank)
     {
-        // default = CPU transfer
-        default:
-            DMA_doCPUCopy(location, from, to, len, step);
-            return TRUE;
+        // transfers overran VBlank ? --> increase margin quickly
+        if (!GET_VDPSTATUS(VDP_VBLANK_FLAG)) autoMargin += maxTransferPerFrame >> 4;
+        // otherwise slowly release it
+        else if (autoMargin) autoMargin -= min(autoMargin, maxTransferPerFrame >> 6);
+    }
 
-        case DMA:
-            DMA_doDma(location, from, to, len, step);
-            return TRUE;
+    // remove done (or ignored) transfers, unfinished background transfers are carried over to next flush
+    count[DMA_LANE_BACKGROUND] = num[DMA_LANE_BACKGROUND];
+    removeTransfers(count);
+    overCapacity = FALSE;
+    if (!queueIndex) fillCopyNum = 0;
 
-        case DMA_QUEUE:
-            return DMA_queueDma(location, from, to, len, step);
+    // fenced frame flushed ? --> release its data buffer
+    if (fenceNum)
+    {
+        u16 f;
 
-        case DMA_QUEUE_COPY:
-            return DMA_copyAndQueueDma(location, from, to, len, step);
+        lastHighWater = fenceHighWater[0];
+        fenceNum--;
+        for(f = 0; f < fenceNum; f++)
+        {
+            for(lane = 0; lane < DMA_LANE_NUM; lane++) fenceIndex[f][lane] = fenceIndex[f + 1][lane];
+            fenceHighWater[f] = fenceHighWater[f + 1];
+        }
     }
+    // no fence --> whole data buffer can be released (background transfers can't use it)
+    else
+    {
+        lastHighWater = highWater;
+        highWater = 0;
+        nextDataBuffer = writeBufferStart;
+    }
+    if (lastHighWater > maxHighWater) maxHighWater = lastHighWater;
+
+    // restore autoInc
+    VDP_setAutoInc(autoInc);
+
+#if (DMA_DISABLED == 0)
+    // HInt slicing enabled ? --> continue remaining background transfers during active display
+    if (sliceSize && laneIndex[DMA_LANE_BACKGROUND]) startSlicing();
+#endif  // DMA_DISABLED
 }
 
-void* DMA_allocateTemp(u16 len)
+void DMA_setTrace(bool value)
 {
-    u16* result = nextDataBuffer;
-
-    nextDataBuffer += len;
+#if (DMA_TRACE != 0)
+    if (traceBuffer)
+    {
+        MEM_free(traceBuffer);
+        traceBuffer = NULL;
+    }
 
-    if (nextDataBuffer > (dataBuffer + dataBufferSize))
+    if (value)
     {
+        traceBuffer = MEM_alloc(DMA_TRACE_SIZE * sizeof(DMATraceEntry));
+
 #if (LIB_LOG_LEVEL >= LOG_LEVEL_ERROR)
-        KLog_U2_("DMA_allocateTemp(..) failed: buffer over capacity (", (u32) (nextDataBuffer - dataBuffer), " raised, max capacity = ", dataBufferSize, ")");
+        if (!traceBuffer) KLog("DMA_setTrace(..) failed: can't allocate trace buffer");
 #endif
-
-        // failed --> revert allocation
-        DMA_releaseTemp(len);
-
-        // error
-        return NULL;
     }
 
-    return result;
+    traceIndex = 0;
+    traceNum = 0;
+    traceFrame = 0;
+#else
+    (void) value;
+#endif
 }
 
-void DMA_releaseTemp(u16 len)
+void DMA_dumpTrace()
 {
-    // release allocation
-    nextDataBuffer -= len;
+#if (DMA_TRACE != 0)
+    static const char* const locations[] = {"VRAM", "CRAM", "VSRAM", "FILL", "COPY"};
+    char str[96];
+    u16 ind;
+    u16 i;
+
+    if (!traceBuffer) return;
+
+    // oldest entry first
+    ind = (traceNum < DMA_TRACE_SIZE) ? 0 : traceIndex;
+    i = traceNum;
+
+    while(i--)
+    {
+        const DMATraceEntry* entry = &traceBuffer[ind];
+
+        if (entry->location == DMA_TRACE_FLUSH)
+            sprintf(str, "DMAF %lu %lu %lu %lu", (u32) entry->frame, entry->from, (u32) entry->to, (u32) entry->len);
+        else
+            sprintf(str, "DMAT %lu %lu %s %06lX %04lX %lu %lu %06lX", (u32) entry->frame, (u32) entry->lane, locations[entry->location],
+                entry->from, (u32) entry->to, (u32) entry->len, (u32) entry->step, entry->site);
+        KLog(str);
+
+        if (++ind == DMA_TRACE_SIZE) ind = 0;
+    }
+#endif
+}
+
+#if (DMA_TRACE != 0)
+static void traceFlush(const u16* num)
+{
+    DMATraceEntry entry;
+    u16 lane;
+    u16 total = 0;
+
+    entry.frame = traceFrame;
+
+    for(lane = 0; lane < DMA_LANE_NUM; lane++)
+    {
+        const DMAOpInfo *info = laneQueue[lane];
+        const u32 *site = laneSite[lane];
+        u16 i = num[lane];
+
+        entry.lane = lane;
+        total += i;
+
+        while(i--)
+        {
+            const u32 cmd = info->regCtrlWrite;
+
+            entry.len = (info->regLen & 0xFF) | ((info->regLen >> 8) & 0xFF00);
+            entry.step = info->regAddrMStep & 0xFF;
+            entry.to = ((cmd >> 16) & 0x3FFF) | ((cmd & 3) << 14);
+            entry.site = *site++;
+
+            // VRAM fill / copy (source is fill value / VRAM address)
+            if (info->regAddrHAddrL & DMA_FILLCOPY_FLAG)
+            {
+                if (info->regAddrHAddrL & 0x00400000)
+                {
+                    entry.location = DMA_TRACE_COPY;
+                    entry.from = ((info->regAddrMStep >> 8) & 0xFF00) | (info->regAddrHAddrL & 0xFF);
+                }
+                else
+                {
+                    entry.location = DMA_TRACE_FILL;
+                    entry.from = (info->regAddrMStep >> 16) & 0xFF;
+                }
+            }
+            else
+            {
+                if ((cmd & 0xC0000000) == 0xC0000000) entry.location = DMA_CRAM;
+                else if (cmd & 0x10) entry.location = DMA_VSRAM;
+                else entry.location = DMA_VRAM;
+                entry.from = ((info->regAddrMStep & 0xFF0000) >> 7) | ((info->regAddrHAddrL & 0x7F00FF) << 1);
+            }
+
+            traceAdd(&entry);
+            info++;
+        }
+    }
+
+    // flush summary: capacity, transferred size and number of operation
+    entry.location = DMA_TRACE_FLUSH;
+    entry.lane = 0;
+    entry.from = lastCapacity;
+    entry.to = lastTransferSize;
+    entry.len = total;
+    entry.step = 0;
+    entry.site = 0;
+    traceAdd(&entry);
+
+    traceFrame++;
+}
+
+static void traceAdd(const DMATraceEntry* entry)
+{
+    traceBuffer[traceIndex] = *entry;
+
+    if (++traceIndex == DMA_TRACE_SIZE) traceIndex = 0;
+    if (traceNum < DMA_TRACE_SIZE) traceNum++;
+}
+
+static void moveSites(u16 lane, u16 removed)
+{
+    u32 *dst = laneSite[lane];
+    u32 *src = dst + removed;
+    u16 i = laneIndex[lane] - removed;
+
+    while(i--) *dst++ = *src++;
+}
+#endif
+
+void DMA_setHIntSlicing(u16 size, u16 interval)
+{
+    // stop current slicing (pending transfers will be done on next flush)
+    if (!size && slicing) stopSlicing();
+
+    // slice size in word (even number of bytes)
+    sliceSize = size & ~1;
+    sliceInterval = max(1, min(interval, 256));
+}
+
+bool DMA_isHIntSlicing()
+{
+    return slicing ? TRUE : FALSE;
+}
+
+static void compactBackground()
+{
+    const u16 head = bgHead;
+    u16 i;
+
+    // remove background transfers done during active display
+    if (head)
+    {
+        DMAOpInfo *dst = laneQueue[DMA_LANE_BACKGROUND];
+        DMAOpInfo *src = dst + head;
+        i = laneIndex[DMA_LANE_BACKGROUND] - head;
+        while(i--) *dst++ = *src++;
+#if (DMA_TRACE != 0)
+        moveSites(DMA_LANE_BACKGROUND, head);
+#endif
+
+        laneIndex[DMA_LANE_BACKGROUND] -= head;
+        queueIndex -= head;
+        bgHead = 0;
+
+        // fenced frames have less background transfers now
+        for(i = 0; i < fenceNum; i++)
+            fenceIndex[i][DMA_LANE_BACKGROUND] = (fenceIndex[i][DMA_LANE_BACKGROUND] > head) ? (fenceIndex[i][DMA_LANE_BACKGROUND] - head) : 0;
+    }
+
+    laneTransferSize[DMA_LANE_BACKGROUND] -= slicedSize;
+    queueTransferSize -= slicedSize;
+    slicedSize = 0;
+}
+
+static void startSlicing()
+{
+    slicing = TRUE;
+
+    SYS_setHIntCallback(hintSlice);
+    VDP_setHIntCounter(sliceInterval - 1);
+    VDP_setHInterrupt(TRUE);
+}
+
+static void stopSlicing()
+{
+    VDP_setHInterrupt(FALSE);
+    SYS_setHIntCallback(NULL);
+
+    slicing = FALSE;
+}
+
+static void hintSlice()
+{
+    // we don't want VBlank flush to interrupt us (queue state is read after masking)
+    const u16 intLevel = SYS_getAndSetInterruptMaskLevel(7);
+    const u16 head = bgHead;
+
+    // all background transfers done --> stop
+    if (head >= laneIndex[DMA_LANE_BACKGROUND])
+    {
+        stopSlicing();
+        SYS_setInterruptMaskLevel(intLevel);
+        return;
+    }
+
+    // VRAM FILL / COPY in progress --> try again on next slice
+    if (GET_VDPSTATUS(VDP_DMABUSY_FLAG))
+    {
+        SYS_setInterruptMaskLevel(intLevel);
+        return;
+    }
+
+    DMAOpInfo *info = &laneQueue[DMA_LANE_BACKGROUND][head];
+    const u32 cmd = info->regCtrlWrite;
+
+    // only VRAM transfers can be done safely during active display (CRAM / VSRAM writes are visible, VRAM fill / copy
+    // would run in parallel) --> stop
+    if (((cmd & 0xC0000000) != 0x40000000) || ((cmd & 0xF0) != 0x80) || (info->regAddrHAddrL & DMA_FILLCOPY_FLAG))
+    {
+        stopSlicing();
+        SYS_setInterruptMaskLevel(intLevel);
+        return;
+    }
+
+    const u16 len = (info->regLen & 0xFF) | ((info->regLen >> 8) & 0xFF00);
+    const u16 sliceLen = sliceSize >> 1;
+    u16 z80restore;
+
+    // define z80 BUSREQ restore state
+    if (Z80_isBusTaken()) z80restore = 0x0100;
+    else z80restore = 0x0000;
+
+    // remaining transfer fits in the slice --> do it entirely
+    if (len <= sliceLen)
+    {
+        doSlice(info, z80restore);
+
+        bgHead = head + 1;
+        slicedSize += len << 1;
+    }
+    else
+    {
+        DMAOpInfo slice;
+        const u16 step = info->regAddrMStep & 0xFF;
+        u32 from = ((info->regAddrMStep & 0xFF0000) >> 7) | ((info->regAddrHAddrL & 0x7F00FF) << 1);
+        u16 to = ((cmd >> 16) & 0x3FFF) | ((cmd & 3) << 14);
+
+        // transfer the first part
+        slice = *info;
+        slice.regLen = ((sliceLen | (sliceLen << 8)) & 0xFF00FF) | 0x94009300;
+        doSlice(&slice, z80restore);
+
+        // and keep the remaining part (transfer never crosses source bank)
+        from += sliceLen << 1;
+        to += sliceLen * step;
+        info->regLen = (((len - sliceLen) | ((len - sliceLen) << 8)) & 0xFF00FF) | 0x94009300;
+        info->regAddrMStep = (((from << 7) & 0xFF0000) | 0x96008F00) + step;
+        info->regAddrHAddrL = ((from >> 1) & 0x7F00FF) | 0x97009500;
+        info->regCtrlWrite = GFX_DMA_VRAM_ADDR((u32)to);
+
+        slicedSize += sliceSize;
+    }
+
+    // restore autoInc (modified by DMA step)
+    VDP_setAutoInc(VDP_getAutoInc());
+
+    SYS_setInterruptMaskLevel(intLevel);
+}
+
+static void doSlice(DMAOpInfo* info, u16 z80restore)
+{
+#if (HALT_Z80_ON_DMA != 0)
+    vu16 *pw = (vu16*) Z80_HALT_PORT;
+
+    // disable Z80 during DMA
+    *pw = 0x0100;
+    flushQueue(info, 1);
+    *pw = z80restore;
+#else
+    flushQueueSafe(info, 1, z80restore);
+#endif
+}
+
+static void flushLane(DMAOpInfo* info, u16 num, u16 z80restore)
+{
+    // no VRAM fill / copy operation --> flush all transfers at once
+    if (!fillCopyNum)
+    {
+        flushRun(info, num, z80restore);
+        return;
+    }
+
+    while(num)
+    {
+        DMAOpInfo *start = info;
+        u16 n = 0;
+
+        // get following standard transfers
+        while((n < num) && !(info->regAddrHAddrL & DMA_FILLCOPY_FLAG))
+        {
+            info++;
+            n++;
+        }
+
+        if (n)
+        {
+            // wait for previous VRAM fill / copy operation to complete
+            VDP_waitDMACompletion();
+            flushRun(start, n, z80restore);
+            num -= n;
+        }
+
+        // VRAM fill / copy operation (doesn't use main BUS)
+        if (num)
+        {
+            doFillCopy(info);
+            info++;
+            num--;
+        }
+    }
+}
+
+static void flushRun(DMAOpInfo* info, u16 num, u16 z80restore)
+{
+    const u16 limit = holdLimit;
+    DMAOpInfo *start = info;
+    u16 n = 0;
+
+    // no BUS hold limit --> transfer all at once
+    if (!limit)
+    {
+        flushDirect(info, num, z80restore);
+        return;
+    }
+
+    while(num--)
+    {
+        const u16 len = (info->regLen & 0xFF) | ((info->regLen >> 8) & 0xFF00);
+
+        // doesn't fit in current window ?
+        if ((holdSize + len) > limit)
+        {
+            // do transfers of current window then give BUS back to Z80
+            if (n) flushDirect(start, n, z80restore);
+            n = 0;
+            if (holdSize) releaseBus(z80restore);
+
+            // transfer larger than a window --> split it
+            if (len > limit)
+            {
+                flushSplit(info, len, z80restore);
+                info++;
+                continue;
+            }
+        }
+
+        if (!n) start = info;
+        holdSize += len;
+        n++;
+        info++;
+    }
+
+    if (n) flushDirect(start, n, z80restore);
+}
+
+static void flushSplit(const DMAOpInfo* info, u16 len, u16 z80restore)
+{
+    DMAOpInfo part;
+    const u16 limit = holdLimit;
+    const u16 step = info->regAddrMStep & 0xFF;
+    const u32 cmd = info->regCtrlWrite;
+    u32 from = ((info->regAddrMStep & 0xFF0000) >> 7) | ((info->regAddrHAddrL & 0x7F00FF) << 1);
+    u16 to = ((cmd >> 16) & 0x3FFF) | ((cmd & 3) << 14);
+
+    while(len)
+    {
+        const u16 l = min(len, limit);
+
+        // previous part done --> give BUS back to Z80
+        if (holdSize) releaseBus(z80restore);
+
+        // transfer never crosses source bank
+        part.regLen = ((l | (l << 8)) & 0xFF00FF) | 0x94009300;
+        part.regAddrMStep = (((from << 7) & 0xFF0000) | 0x96008F00) + step;
+        part.regAddrHAddrL = ((from >> 1) & 0x7F00FF) | 0x97009500;
+        // keep destination type (VRAM / CRAM / VSRAM)
+        part.regCtrlWrite = (cmd & 0xC000FFFC) | ((u32) (to & 0x3FFF) << 16) | ((to >> 14) & 3);
+        flushDirect(&part, 1, z80restore);
+
+        holdSize = l;
+        from += l << 1;
+        to += l * step;
+        len -= l;
+    }
+}
+
+static void flushDirect(DMAOpInfo* info, u16 num, u16 z80restore)
+{
+#if (HALT_Z80_ON_DMA != 0)
+    flushQueue(info, num);
+#else
+    flushQueueSafe(info, num, z80restore);
+#endif
+}
+
+static void releaseBus(u16 z80restore)
+{
+    if (holdSize > maxHoldSize) maxHoldSize = holdSize;
+    holdSize = 0;
+
+#if (HALT_Z80_ON_DMA != 0)
+    vu16 *pw = (vu16*) Z80_HALT_PORT;
+
+    // let Z80 run a bit
+    *pw = z80restore;
+    waitSubTick(DMA_BUS_RELEASE_SUBTICK);
+    *pw = 0x0100;
+#else
+    // DMA is done so Z80 can access main BUS now
+    waitSubTick(DMA_BUS_RELEASE_SUBTICK);
+#endif
+}
+
+static void doFillCopy(const DMAOpInfo* info)
+{
+    vu32 *pl;
+
+    // wait for previous VRAM fill / copy operation to complete
+    VDP_waitDMACompletion();
+
+    pl = (vu32*) GFX_CTRL_PORT;
+
+    // setup DMA length, step, source (copy) and operation
+    *pl = info->regLen;
+    *pl = info->regAddrMStep;
+    *pl = info->regAddrHAddrL;
+    // write VRAM destination address (start VRAM copy operation)
+    *pl = info->regCtrlWrite;
+
+    // VRAM fill ? --> write fill value to start operation (need to be 16 bits extended)
+    if (!(info->regAddrHAddrL & 0x00400000))
+    {
+        const u16 value = (info->regAddrMStep >> 16) & 0xFF;
+        *((vu16*) GFX_DATA_PORT) = value | (value << 8);
+    }
+}
+
+static u16 getLaneFlushNum(u16 lane, u16 num, u16 capacity)
+{
+    const DMAOpInfo *info = laneQueue[lane];
+    u16 size = 0;
+    u16 i;
+
+    // number of transfers (among the first 'num' ones) fitting in the given capacity
+    for(i = 0; i < num; i++)
+    {
+        size += ((info->regLen & 0xFF) | ((info->regLen >> 8) & 0xFF00)) << 1;
+        if (size > capacity) break;
+        info++;
+    }
+
+    return i;
+}
+
+static void removeTransfers(const u16* removed)
+{
+    u16 lane;
+
+    for(lane = 0; lane < DMA_LANE_NUM; lane++)
+    {
+        const u16 n = removed[lane];
+
+        if (!n) continue;
+
+        const u16 size = getLaneSize(lane, n);
+        const u16 remaining = laneIndex[lane] - n;
+        DMAOpInfo *dst = laneQueue[lane];
+        DMAOpInfo *src = dst + n;
+        u16 i;
+
+        // move remaining transfers to the start of the lane queue
+        i = remaining;
+        while(i--) *dst++ = *src++;
+#if (DMA_TRACE != 0)
+        moveSites(lane, n);
+#endif
+
+        laneIndex[lane] = remaining;
+        laneTransferSize[lane] -= size;
+        queueIndex -= n;
+        queueTransferSize -= size;
+
+        // fenced frames transfers moved as well
+        for(i = 0; i < fenceNum; i++)
+            fenceIndex[i][lane] = (fenceIndex[i][lane] > n) ? (fenceIndex[i][lane] - n) : 0;
+
+        // nothing to merge with anymore
+        if (!remaining) laneLastOp[lane].location = 0xFFFF;
+    }
+}
+
+static u16 getLaneSize(u16 lane, u16 num)
+{
+    const DMAOpInfo *info = laneQueue[lane];
+    u16 size = 0;
+
+    // size of the first 'num' transfers
+    while(num--)
+    {
+        size += ((info->regLen & 0xFF) | ((info->regLen >> 8) & 0xFF00)) << 1;
+        info++;
+    }
+
+    return size;
+}
+
+//static void flushQueue(DMAOpInfo* queue, u16 num)
+//{
+//    u32 *info = (u32*) queue;
+//    vu32 *pl = (vu32*) GFX_CTRL_PORT;
+//    u16 i = num;
+//
+//    // flush DMA queue
+//    while(i--)
+//    {
+//        *pl = *info++;  // regLen = 0x94000x9300 | (len | (len << 8) & 0xFF00FF)
+//        *pl = *info++;  // regAddrMStep = 0x96008F00 | ((from << 7) & 0xFF0000) | step
+//        *pl = *info++;  // regAddrHAddrL = 0x97009500 | ((from >> 1) & 0x7F00FF)
+//        *pl = *info++;  // regCtrlWrite =  GFX_DMA_xxx_ADDR(to)
+//    }
+//}
+//
+//static void flushQueueSafe(DMAOpInfo* queue, u16 num, u16 z80restore)
+//{
+//    // z80 BUSREQ off state
+//    const u16 z80off = 0x0100;
+//    const u16 z80on = z80restore;
+//
+//    u32 *info = (u32*) queue;
+//    vu32 *pl = (vu32*) GFX_CTRL_PORT;
+//    vu16 *pw = (vu16*) Z80_HALT_PORT;
+//    u16 i = num;
+//
+//    // flush DMA queue
+//    while(i--)
+//    {
+//        *pl = *info++;  // regLen = 0x94000x9300 | (len | (len << 8) & 0xFF00FF)
+//        *pl = *info++;  // regAddrMStep = 0x96008F00 | ((from << 7) & 0xFF0000) | step
+//        *pl = *info++;  // regAddrHAddrL = 0x97009500 | ((from >> 1) & 0x7F00FF)
+//
+//        // DISABLE and RE-ENABLE Z80 immediately
+//        // This allow to avoid DMA failure on some MD
+//        // when Z80 try to access 68k BUS at same time the DMA starts.
+//        // BUS arbitrer lantecy will disable Z80 for a very small amont of time
+//        // when DMA start, avoiding that situation to happen.
+//        *pw = z80off;
+//        *pw = z80on;
+//
+//        // then trigger DMA
+//        *pl = *info++;  // regCtrlWrite =  GFX_DMA_xxx_ADDR(to)
+//    }
+//}
+
+u16 DMA_getQueueSize()
+{
+    return queueIndex;
+}
+
+u16 DMA_getQueueTransferSize()
+{
+    return queueTransferSize;
+}
+
+u16 DMA_getLaneTransferSize(u16 lane)
+{
+    return laneTransferSize[lane];
+}
+
+u32 DMA_getNumMergedTransfer()
+{
+    return mergedNum;
+}
+
+bool DMA_transfer(TransferMethod tm, u8 location, void* from, u16 to, u16 len, u16 step)
+{
+    TRACE_SITE();
+
+    switch(tm)
+    {
+        // default = CPU transfer
+        default:
+            DMA_doCPUCopy(location, from, to, len, step);
+            return TRUE;
+
+        case DMA:
+            DMA_doDma(location, from, to, len, step);
+            return TRUE;
+
+        case DMA_QUEUE:
+            return queueDma(location, from, to, len, step, DMA_LANE_NORMAL);
+
+        case DMA_QUEUE_COPY:
+            return copyAndQueueDma(location, from, to, len, step);
+    }
+}
+
+void* DMA_allocateTemp(u16 len)
+{
+    u16* result = nextDataBuffer;
+
+    nextDataBuffer += len;
+
+    if (nextDataBuffer > writeBufferEnd)
+    {
+#if (LIB_LOG_LEVEL >= LOG_LEVEL_ERROR)
+        KLog_U2_("DMA_allocateTemp(..) failed: buffer over capacity (", (u32) (nextDataBuffer - writeBufferStart), " raised, max capacity = ", bufferSegSize, ")");
+#endif
+
+        // failed --> revert allocation
+        DMA_releaseTemp(len);
+
+        // error
+        return NULL;
+    }
+
+    // update high-water mark of current frame
+    const u16 used = nextDataBuffer - writeBufferStart;
+    if (used > highWater) highWater = used;
+
+    return result;
+}
+
+void DMA_releaseTemp(u16 len)
+{
+    // release allocation
+    nextDataBuffer -= len;
 }
 
 void* DMA_allocateAndQueueDma(u8 location, u16 to, u16 len, u16 step)
 {
+    TRACE_SITE();
+
+    return allocateAndQueueDma(location, to, len, step, DMA_LANE_NORMAL);
+}
+
+void* DMA_allocateAndQueueDmaEx(u8 location, u16 to, u16 len, u16 step, u16 lane)
+{
+    TRACE_SITE();
+
+    return allocateAndQueueDma(location, to, len, step, lane);
+}
+
+static void* allocateAndQueueDma(u8 location, u16 to, u16 len, u16 step, u16 lane)
+{
+    // temporary buffer is released on flush so its data can't be carried over --> use normal lane
+    if (lane == DMA_LANE_BACKGROUND) lane = DMA_LANE_NORMAL;
+
     u16* result = DMA_allocateTemp(len);
 
     // can't allocate --> exit
@@ -391,7 +1497,7 @@ void* DMA_allocateAndQueueDma(u8 location, u16 to, u16 len, u16 step)
 #endif
 
     // try to queue the DMA transfer
-    if (!DMA_queueDma(location, result, to, len, step))
+    if (!queueDma(location, result, to, len, step, lane))
     {
         // failed --> release allocation
         DMA_releaseTemp(len);
@@ -404,6 +1510,13 @@ void* DMA_allocateAndQueueDma(u8 location, u16 to, u16 len, u16 step)
 }
 
 bool DMA_copyAndQueueDma(u8 location, void* from, u16 to, u16 len, u16 step)
+{
+    TRACE_SITE();
+
+    return copyAndQueueDma(location, from, to, len, step);
+}
+
+static bool copyAndQueueDma(u8 location, void* from, u16 to, u16 len, u16 step)
 {
     u16* buffer = DMA_allocateTemp(len);
 
@@ -418,7 +1531,7 @@ bool DMA_copyAndQueueDma(u8 location, void* from, u16 to, u16 len, u16 step)
     memcpyU16(buffer, from, len * 2);
 
     // try to queue the DMA transfer
-    if (!DMA_queueDma(location, buffer, to, len, step))
+    if (!queueDma(location, buffer, to, len, step, DMA_LANE_NORMAL))
     {
         // failed --> release allocation
         DMA_releaseTemp(len);
@@ -430,102 +1543,268 @@ bool DMA_copyAndQueueDma(u8 location, void* from, u16 to, u16 len, u16 step)
 }
 
 bool DMA_queueDma(u8 location, void* from, u16 to, u16 len, u16 step)
+{
+    TRACE_SITE();
+
+    return queueDma(location, from, to, len, step, DMA_LANE_NORMAL);
+}
+
+bool DMA_queueDmaEx(u8 location, void* from, u16 to, u16 len, u16 step, u16 lane)
+{
+    TRACE_SITE();
+
+    return queueDma(location, from, to, len, step, lane);
+}
+
+static bool queueDma(u8 location, void* from, u16 to, u16 len, u16 step, u16 lane)
 {
     u32 fromAddr;
     u32 bankLimitB;
     u32 bankLimitW;
     DMAOpInfo *info;
+    DMALastOp *last;
     u16 newLen;
 
-    // queue is full --> error
-    if (queueIndex >= queueSize)
-    {
-#if (LIB_LOG_LEVEL >= LOG_LEVEL_ERROR)
-        KDebug_Alert("DMA_queueDma(..) failed: queue is full !");
-#endif
-
-        // return FALSE as transfer will be ignored
-        return FALSE;
-    }
-
     // DMA works on 64 KW bank
     fromAddr = (u32) from;
     bankLimitB = 0x20000 - (fromAddr & 0x1FFFF);
     bankLimitW = bankLimitB >> 1;
     // bank limit exceeded
-    if (len > bankLimitW)
+    if ((laneIndex[lane] < laneSize[lane]) && (len > bankLimitW))
     {
         // we first do the second bank transfer
-        DMA_queueDma(location, (void*) (fromAddr + bankLimitB), to + bankLimitB, len - bankLimitW, step);
+        queueDma(location, (void*) (fromAddr + bankLimitB), to + bankLimitB, len - bankLimitW, step, lane);
         newLen = bankLimitW;
     }
     // ok, use normal len
     else newLen = len;
 
-    // get DMA info structure and pass to next one
-    info = &dmaQueues[queueIndex];
+    last = &laneLastOp[lane];
 
-    // $14:len H  $13:len L (DMA length in word)
-    info->regLen = ((newLen | (newLen << 8)) & 0xFF00FF) | 0x94009300;
-    // $16:M  $f:step (DMA address M and Step register)
-    info->regAddrMStep = (((fromAddr << 7) & 0xFF0000) | 0x96008F00) + step;
-    // $17:H  $15:L (DMA address H & L)
-    info->regAddrHAddrL = ((fromAddr >> 1) & 0x7F00FF) | 0x97009500;
+    // contiguous (source and destination) with previous transfer of this lane and in the same source bank ?
+    bool merge = (last->location == location) && (last->step == step) && (last->fromEnd == fromAddr) && (last->toEnd == to) &&
+        (((last->from ^ (fromAddr + (newLen * 2) - 1)) & ~0x1FFFF) == 0) && (((u32) last->len + newLen) <= 0xFFFF);
 
-    // Trigger DMA
-    switch(location)
+    // don't merge with a background transfer which may be in progress or already (partially) done in HInt slicing
+    if (merge && (lane == DMA_LANE_BACKGROUND) && (slicing || bgHead || slicedSize))
+        merge = FALSE;
+    // don't merge a transfer which will be ignored with a transfer which won't
+    if (merge && (lane == DMA_LANE_NORMAL) && (flag & DMA_OVERCAPACITY_IGNORE) &&
+        (((u32) laneTransferSize[DMA_LANE_CRITICAL] + laneTransferSize[DMA_LANE_NORMAL] + (newLen * 2)) > maxTransferPerFrame))
+        merge = FALSE;
+
+    // --> merge them
+    if (merge)
     {
-    case DMA_VRAM:
-        info->regCtrlWrite = GFX_DMA_VRAM_ADDR((u32)to);
+        info = &laneQueue[lane][laneIndex[lane] - 1];
+
+        last->len += newLen;
+        last->fromEnd += newLen * 2;
+        last->toEnd += newLen * step;
+        // $14:len H  $13:len L (DMA length in word)
+        info->regLen = ((last->len | (last->len << 8)) & 0xFF00FF) | 0x94009300;
+        mergedNum++;
+
 #ifdef DMA_DEBUG
-        KLog_U4("DMA_queueDma: VRAM from=", fromAddr, " to=", to, " len=", len, " step=", step);
+        KLog_U4("DMA_queueDma: merged from=", fromAddr, " to=", to, " len=", newLen, " total len=", last->len);
 #endif
-        break;
+    }
+    else
+    {
+        // queue is full --> error
+        if (laneIndex[lane] >= laneSize[lane])
+        {
+#if (LIB_LOG_LEVEL >= LOG_LEVEL_ERROR)
+            KDebug_Alert("DMA_queueDma(..) failed: queue is full !");
+#endif
+
+            // return FALSE as transfer will be ignored
+            return FALSE;
+        }
+
+        // get DMA info structure and pass to next one
+        info = &laneQueue[lane][laneIndex[lane]];
 
-    case DMA_CRAM:
-        info->regCtrlWrite = GFX_DMA_CRAM_ADDR((u32)to);
+        // $14:len H  $13:len L (DMA length in word)
+        info->regLen = ((newLen | (newLen << 8)) & 0xFF00FF) | 0x94009300;
+        // $16:M  $f:step (DMA address M and Step register)
+        info->regAddrMStep = (((fromAddr << 7) & 0xFF0000) | 0x96008F00) + step;
+        // $17:H  $15:L (DMA address H & L)
+        info->regAddrHAddrL = ((fromAddr >> 1) & 0x7F00FF) | 0x97009500;
+
+        // Trigger DMA
+        switch(location)
+        {
+        case DMA_VRAM:
+            info->regCtrlWrite = GFX_DMA_VRAM_ADDR((u32)to);
 #ifdef DMA_DEBUG
-        KLog_U4("DMA_queueDma: CRAM from=", fromAddr, " to=", to, " len=", len, " step=", step);
+            KLog_U4("DMA_queueDma: VRAM from=", fromAddr, " to=", to, " len=", len, " step=", step);
 #endif
-        break;
+            break;
 
-    case DMA_VSRAM:
-        info->regCtrlWrite = GFX_DMA_VSRAM_ADDR((u32)to);
+        case DMA_CRAM:
+            info->regCtrlWrite = GFX_DMA_CRAM_ADDR((u32)to);
 #ifdef DMA_DEBUG
-        KLog_U4("DMA_queueDma: VSRAM from=", fromAddr, " to=", to, " len=", len, " step=", step);
+            KLog_U4("DMA_queueDma: CRAM from=", fromAddr, " to=", to, " len=", len, " step=", step);
+#endif
+            break;
+
+        case DMA_VSRAM:
+            info->regCtrlWrite = GFX_DMA_VSRAM_ADDR((u32)to);
+#ifdef DMA_DEBUG
+            KLog_U4("DMA_queueDma: VSRAM from=", fromAddr, " to=", to, " len=", len, " step=", step);
+#endif
+            break;
+        }
+
+#if (DMA_TRACE != 0)
+        laneSite[lane][laneIndex[lane]] = traceSite;
 #endif
-        break;
+
+        // store it so next transfer can be merged with it
+        last->from = fromAddr;
+        last->fromEnd = fromAddr + (newLen * 2);
+        last->toEnd = to + (newLen * step);
+        last->len = newLen;
+        last->step = step;
+        last->location = location;
+
+        // pass to next index
+        laneIndex[lane]++;
+        queueIndex++;
     }
 
-    // pass to next index
-    queueIndex++;
     // keep trace of transferred size
+    laneTransferSize[lane] += newLen << 1;
     queueTransferSize += newLen << 1;
 
 #ifdef DMA_DEBUG
-    KLog_U2("  Queue index=", queueIndex, " new queueTransferSize=", queueTransferSize);
+    KLog_U3("  Queue index=", queueIndex, " lane=", lane, " new queueTransferSize=", queueTransferSize);
+#endif
+
+    return checkCapacity(lane);
+}
+
+bool DMA_queueVRamFill(u16 to, u16 len, u8 value, u16 step)
+{
+    TRACE_SITE();
+
+    return queueVRamFill(to, len, value, step, DMA_LANE_NORMAL);
+}
+
+bool DMA_queueVRamFillEx(u16 to, u16 len, u8 value, u16 step, u16 lane)
+{
+    TRACE_SITE();
+
+    return queueVRamFill(to, len, value, step, lane);
+}
+
+static bool queueVRamFill(u16 to, u16 len, u8 value, u16 step, u16 lane)
+{
+    u16 l;
+
+    // need to do some adjustement because of the way VRAM fill is done (see DMA_doVRamFill(..))
+    if (len)
+    {
+        if (to & 1) l = (len < 3) ? 1 : (len - 2);
+        else l = (len < 2) ? 1 : (len - 1);
+    }
+    else l = len;
+
+#ifdef DMA_DEBUG
+    KLog_U4("DMA_queueVRamFill: to=", to, " len=", len, " value=", value, " step=", step);
 #endif
 
+    // $16 register isn't used by VRAM fill so we store the fill value here
+    return queueFillCopy(lane, ((l | (l << 8)) & 0xFF00FF) | 0x94009300, ((0x9600 | value) << 16) | 0x8F00 | (step & 0xFF),
+        0x97809500, GFX_DMA_VRAM_ADDR((u32)to));
+}
+
+bool DMA_queueVRamCopy(u16 from, u16 to, u16 len, u16 step)
+{
+    TRACE_SITE();
+
+    return queueVRamCopy(from, to, len, step, DMA_LANE_NORMAL);
+}
+
+bool DMA_queueVRamCopyEx(u16 from, u16 to, u16 len, u16 step, u16 lane)
+{
+    TRACE_SITE();
+
+    return queueVRamCopy(from, to, len, step, lane);
+}
+
+static bool queueVRamCopy(u16 from, u16 to, u16 len, u16 step, u16 lane)
+{
+#ifdef DMA_DEBUG
+    KLog_U4("DMA_queueVRamCopy: from=", from, " to=", to, " len=", len, " step=", step);
+#endif
+
+    return queueFillCopy(lane, ((len | (len << 8)) & 0xFF00FF) | 0x94009300, (((u32) from << 8) & 0xFF0000) | 0x96008F00 | (step & 0xFF),
+        0x97C09500 | (from & 0xFF), GFX_DMA_VRAMCOPY_ADDR((u32)to));
+}
+
+static bool queueFillCopy(u16 lane, u32 regLen, u32 regAddrMStep, u32 regAddrHAddrL, u32 regCtrlWrite)
+{
+    DMAOpInfo *info;
+
+    // queue is full --> error
+    if (laneIndex[lane] >= laneSize[lane])
+    {
+#if (LIB_LOG_LEVEL >= LOG_LEVEL_ERROR)
+        KDebug_Alert("DMA_queueVRamFill/Copy(..) failed: queue is full !");
+#endif
+
+        // return FALSE as operation will be ignored
+        return FALSE;
+    }
+
+    info = &laneQueue[lane][laneIndex[lane]];
+    info->regLen = regLen;
+    info->regAddrMStep = regAddrMStep;
+    info->regAddrHAddrL = regAddrHAddrL;
+    info->regCtrlWrite = regCtrlWrite;
+#if (DMA_TRACE != 0)
+    laneSite[lane][laneIndex[lane]] = traceSite;
+#endif
+
+    // can't merge with a VRAM fill / copy operation
+    laneLastOp[lane].location = 0xFFFF;
+
+    // pass to next index
+    laneIndex[lane]++;
+    queueIndex++;
+    fillCopyNum++;
+
+    // keep trace of size (use DMA length register so VRAM copy, which is about twice slower than 68000 DMA, is counted
+    // as 2 bytes per copied byte and VRAM fill conservatively as well)
+    const u16 size = ((regLen & 0xFF) | ((regLen >> 8) & 0xFF00)) << 1;
+    laneTransferSize[lane] += size;
+    queueTransferSize += size;
+
+    return checkCapacity(lane);
+}
+
+static bool checkCapacity(u16 lane)
+{
+    // background transfers are never ignored (carried over to next flush when above the limit)
+    if (lane == DMA_LANE_BACKGROUND) return TRUE;
+
     // we are above the defined limit ?
-    if (queueTransferSize > maxTransferPerFrame)
+    if ((laneTransferSize[DMA_LANE_CRITICAL] + laneTransferSize[DMA_LANE_NORMAL]) > maxTransferPerFrame)
     {
-        // first time we reach the limit ? store index where to stop transfer
-        if (queueIndexLimit == 0)
+        // first time we reach the limit ?
+        if (!overCapacity)
         {
 #if (LIB_LOG_LEVEL >= LOG_LEVEL_WARNING)
             KLog_S3("DMA_queueDma(..) warning: transfer size limit raised on transfer #", queueIndex - 1, ", current size = ", queueTransferSize, "  max allowed = ", maxTransferPerFrame);
 #endif
 
-            // store limit index
-            queueIndexLimit = queueIndex - 1;
-
-#ifdef DMA_DEBUG
-            KLog_U1("  Queue index limit set at ", queueIndexLimit);
-#endif
+            overCapacity = TRUE;
         }
 
-        // return FALSE if transfer will be ignored
-        return (flag & DMA_OVERCAPACITY_IGNORE) ? FALSE : TRUE;
+        // return FALSE if transfer will be ignored (critical transfers are always done)
+        return ((lane == DMA_LANE_NORMAL) && (flag & DMA_OVERCAPACITY_IGNORE)) ? FALSE : TRUE;
     }
 
     return TRUE;
@@ -2,10 +2,10 @@
 #include "asm_mac.i"
 
 func flushQueue
-	move.w 6(%sp),%d0
+	move.w 10(%sp),%d0
     jeq     .fq_end
 
-	move.l dmaQueues,%a0
+	move.l 4(%sp),%a0       | DMA queue lane
 	move.l #0xC00004,%a1
 
 	subq.w #1,%d0           | prepare for dbra
@@ -23,15 +23,15 @@ func flushQueue
 	rts
 
 func flushQueueSafe
-	move.w 6(%sp),%d0
+	move.w 10(%sp),%d0
     jeq     .fqs_end
 
-	move.w 10(%sp),%d1      | z80 restore
+	move.w 14(%sp),%d1      | z80 restore
+	move.l 4(%sp),%a0       | DMA queue lane
 
 	move.w %d2,-(%sp)       | save regs
 	move.l %a2,-(%sp)
 
-	move.l dmaQueues,%a0
 	move.l #0xC00004,%a1
 	move.l #0xA11100,%a2
 	move.w #0x0100,%d2      | z80 off
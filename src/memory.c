@@ -12,6 +12,13 @@
 
 #define USED        1
 
+// small blocks (up to SMALL_MAX bytes) are allocated by size class of 4 bytes and recycled through free lists
+#define SMALL_MAX   64
+#define SMALL_NUM   (SMALL_MAX / 4)
+// tag stored in the unused upper byte of the next block pointer of small free lists (used to detect double release)
+#define SMALL_TAG   0x5A000000
+#define SMALL_NEXT(b)   ((u16*) (*((u32*) ((b) + 1)) & 0x00FFFFFF))
+
 
 // end of bss segment --> start of heap
 extern u32 _bend;
@@ -148,10 +155,58 @@ extern u32 _bend;
 
  // forward
 static u16* pack(u16 nsize);
+static void releaseSmall();
+#if (LIB_LOG_LEVEL >= LOG_LEVEL_ERROR)
+static bool isSmallCached(u16* b);
+#endif
 
 static u16* free;
 static u16* heap;
 
+/*
+ * Released small blocks are kept marked as used in the heap and linked by size class (next block pointer is stored
+ * in block data with SMALL_TAG in its upper byte) so they can be allocated / released in constant time. They are given back to the heap on MEM_pack()
+ * or when an allocation can't be satisfied otherwise.
+ */
+static u16* smallList[SMALL_NUM];
+// total size of blocks in small free lists
+static u16 smallCached;
+
+// per frame scratch arena
+static MemArena frameArena;
+
+// incremental packing position (block header)
+static u16* packPos;
+// free blocks merged during current incremental packing pass
+static bool packMerged;
+// number of blocks visited per frame for automatic incremental packing (0 = disabled)
+static u16 autoPackNum;
+
+#if (MEM_TRACKING != 0)
+// tracked allocation
+typedef struct
+{
+    void *ptr;
+    void *site;
+    u16 size;
+    u16 tag;
+    u16 serial;
+} MemTrackEntry;
+
+static MemTrackEntry trackTable[MEM_TRACK_SIZE];
+// number of allocations which couldn't be tracked (table full)
+static u16 trackLost;
+static u16 allocSerial;
+static u16 currentTag;
+static u16 tagAllocated[MEM_TAG_NUM];
+static u16 allocated;
+static u16 peakAllocated;
+static u16 worstFragmentation;
+
+static void trackAlloc(void *ptr, u16 size, void *site);
+static void trackFree(void *ptr);
+#endif
+
 void MEM_init()
 {
     u32 h;
@@ -179,6 +234,25 @@ void MEM_init()
     // free memory: whole heap
     free = heap;
 
+    // incremental packing starts from heap
+    packPos = heap;
+    packMerged = FALSE;
+    autoPackNum = 0;
+
+    // no small block yet
+    memset(smallList, 0, sizeof(smallList));
+    smallCached = 0;
+
+#if (MEM_TRACKING != 0)
+    memset(trackTable, 0, sizeof(trackTable));
+    memset(tagAllocated, 0, sizeof(tagAllocated));
+    trackLost = 0;
+    allocSerial = 0;
+    currentTag = MEM_TAG_SYS;
+    allocated = 0;
+    MEM_resetStats();
+#endif
+
     // mark end of heap memory
     heap[len >> 1] = 0;
 }
@@ -202,7 +276,8 @@ u16 MEM_getFree()
         b += bsize >> 1;
     }
 
-    return res;
+    // blocks in small free lists are available too
+    return res + smallCached;
 }
 
 u16 MEM_getLargestFreeBlock()
@@ -253,7 +328,8 @@ u16 MEM_getAllocated()
         b += bsize >> 1;
     }
 
-    return res;
+    // blocks in small free lists aren't allocated
+    return res - smallCached;
 }
 
 void* MEM_alloc(u16 size)
@@ -265,11 +341,41 @@ void* MEM_alloc(u16 size)
     if (size == 0)
         return 0;
 
+    // small block ? --> try its size class free list first
+    if (size <= SMALL_MAX)
+    {
+        const u16 cls = (size - 1) >> 2;
+
+        p = smallList[cls];
+
+        if (p)
+        {
+            // unlink it (next block pointer is stored in block data)
+            smallList[cls] = SMALL_NEXT(p);
+            smallCached -= *p & ~USED;
+            // clear tag so block isn't seen as released anymore
+            *((u32*) (p + 1)) = 0;
+
+#if (MEM_TRACKING != 0)
+            trackAlloc(p + 1, size, __builtin_return_address(0));
+#endif
+
+            // block is still marked as used
+            return p + 1;
+        }
+
+        // allocate it with the size class size so it can be recycled for any size of the class
+        size = (cls + 1) << 2;
+    }
+
     // 2 bytes aligned
     adjsize = (size + sizeof(u16) + 1) & 0xFFFE;
 
     if (adjsize > *free)
     {
+        // give small free blocks back to heap so they can be packed (avoid fragmentation)
+        if (smallCached) releaseSmall();
+
         p = pack(adjsize);
 
         // no enough memory
@@ -281,6 +387,9 @@ void* MEM_alloc(u16 size)
             else
                 KLog_U3_("MEM_alloc(", size, ") failed: cannot find a big enough memory block (largest free block = ", MEM_getLargestFreeBlock(), " - free = ", MEM_getFree(), ")");
 #endif
+#if (MEM_TRACKING != 0)
+            KLog_U3("  tag = ", currentTag, " - site = ", (u32) __builtin_return_address(0), " - peak allocated = ", peakAllocated);
+#endif
 
             return NULL;
         }
@@ -313,6 +422,10 @@ void* MEM_alloc(u16 size)
     // set block size, mark as used and point to free region
     *p++ = adjsize | USED;
 
+#if (MEM_TRACKING != 0)
+    trackAlloc(p, size, __builtin_return_address(0));
+#endif
+
 #if (LIB_LOG_LEVEL >= LOG_LEVEL_INFO)
     KLog_U3("MEM_alloc(", size, ") success: ", (u32) p, " - remaining = ", MEM_getFree());
 #endif
@@ -335,8 +448,36 @@ void MEM_free(void *ptr)
         }
 #endif
 
+        u16* b = ((u16*)ptr) - 1;
+        const u16 bsize = *b & ~USED;
+
+        // small block already head of its free list (released twice in a row) ? --> ignore (would create a cycle in the list)
+        if ((bsize <= (SMALL_MAX + sizeof(u16))) && (b == smallList[(bsize - (4 + sizeof(u16))) >> 2])) return;
+
+#if (LIB_LOG_LEVEL >= LOG_LEVEL_ERROR)
+        // already in a small free list ? (tag can match user data so confirm by searching the list)
+        if (((*((u32*) ptr) & 0xFF000000) == SMALL_TAG) && isSmallCached(b))
+        {
+            KLog_U1_("MEM_free(", (u32) ptr, ") failed: block is already released !");
+            return;
+        }
+#endif
+
+#if (MEM_TRACKING != 0)
+        trackFree(ptr);
+#endif
+
+        // small block (only allocated by size class) ? --> put it in its size class free list (it stays marked as used)
+        if (bsize <= (SMALL_MAX + sizeof(u16)))
+        {
+            const u16 cls = (bsize - (4 + sizeof(u16))) >> 2;
+
+            *((u32*) ptr) = ((u32) smallList[cls]) | SMALL_TAG;
+            smallList[cls] = b;
+            smallCached += bsize;
+        }
         // mark block as no more used
-        ((u16*)ptr)[-1] &= ~USED;
+        else *b = bsize;
 
 #if (LIB_LOG_LEVEL >= LOG_LEVEL_INFO)
         KLog_U2("MEM_free(", (u32) ptr, ") --> remaining = ", MEM_getFree());
@@ -351,6 +492,9 @@ void MEM_pack()
     u16 bsize, psize;
     bool first;
 
+    // give small free blocks back to heap first
+    releaseSmall();
+
     b = heap;
     best = b;
     bsize = 0;
@@ -394,6 +538,80 @@ void MEM_pack()
 
     // last free block update
     if (bsize != 0) *best = bsize;
+
+    // heap is packed, restart incremental packing pass
+    packPos = heap;
+    packMerged = FALSE;
+}
+
+bool MEM_packStep(u16 maxBlock)
+{
+    u16 *b;
+    u16 psize;
+
+    b = packPos;
+
+    while (maxBlock--)
+    {
+        psize = *b;
+
+        // end of heap
+        if (psize == 0)
+        {
+            b = heap;
+
+            // complete pass without merge --> heap is packed
+            if (!packMerged)
+            {
+                packPos = b;
+                return TRUE;
+            }
+
+            // start a new pass
+            packMerged = FALSE;
+        }
+        else if (psize & USED)
+            // point to next memory block
+            b += psize >> 1;
+        else
+        {
+            u16 *next = b + (psize >> 1);
+            u16 nsize;
+
+            // merge following free blocks
+            while (maxBlock && (nsize = *next) && !(nsize & USED))
+            {
+                // next free block is merged --> point to merged block
+                if (next == free) free = b;
+
+                psize += nsize;
+                next += nsize >> 1;
+                packMerged = TRUE;
+                maxBlock--;
+            }
+
+            // store packed free size
+            *b = psize;
+            // use largest free block for next allocation
+            if (psize > *free) free = b;
+
+            b = next;
+        }
+    }
+
+    packPos = b;
+
+    return FALSE;
+}
+
+void MEM_setAutoPack(u16 maxBlockPerFrame)
+{
+    autoPackNum = maxBlockPerFrame;
+}
+
+void MEM_doAutoPack()
+{
+    if (autoPackNum) MEM_packStep(autoPackNum);
 }
 
 
@@ -405,6 +623,9 @@ void MEM_dump()
     u16 psize;
     u16 memused;
     u16 memfree;
+#if (MEM_TRACKING != 0)
+    u16 i;
+#endif
 
     KDebug_Alert("Memory dump:");
     KDebug_Alert(" Used blocks:");
@@ -459,8 +680,501 @@ void MEM_dump()
     KDebug_AlertNumber(memused);
     KDebug_Alert("Total free:");
     KDebug_AlertNumber(memfree);
+    KDebug_Alert("Small free blocks (counted as used):");
+    KDebug_AlertNumber(smallCached);
+
+#if (MEM_TRACKING != 0)
+    KDebug_Alert("Peak allocated:");
+    KDebug_AlertNumber(peakAllocated);
+    KDebug_Alert("Worst fragmentation (%):");
+    KDebug_AlertNumber(worstFragmentation);
+    KDebug_Alert("Allocated per tag:");
+    for(i = 0; i < MEM_TAG_NUM; i++)
+    {
+        if (tagAllocated[i])
+        {
+            strcpy(str, "    tag ");
+            intToStr(i, strNum, 0);
+            strcat(str, strNum);
+            strcat(str, ": ");
+            intToStr(tagAllocated[i], strNum, 0);
+            strcat(str, strNum);
+            KDebug_Alert(str);
+        }
+    }
+    if (trackLost)
+    {
+        KDebug_Alert("Untracked allocations (table full):");
+        KDebug_AlertNumber(trackLost);
+    }
+#endif
+}
+
+u16 MEM_getFragmentation()
+{
+    // blocks in small free lists are still marked as used in the heap so they can't be part of largest free block
+    const u16 memfree = MEM_getFree() - smallCached;
+
+    if (memfree == 0) return 0;
+
+    return 100 - (u16) (((u32) MEM_getLargestFreeBlock() * 100) / memfree);
+}
+
+u16 MEM_setTag(u16 tag)
+{
+#if (MEM_TRACKING != 0)
+    const u16 prev = currentTag;
+
+    currentTag = tag & (MEM_TAG_NUM - 1);
+
+    return prev;
+#else
+    return tag;
+#endif
+}
+
+u16 MEM_getTagAllocated(u16 tag)
+{
+#if (MEM_TRACKING != 0)
+    return tagAllocated[tag & (MEM_TAG_NUM - 1)];
+#else
+    return 0;
+#endif
+}
+
+u16 MEM_getPeakAllocated()
+{
+#if (MEM_TRACKING != 0)
+    return peakAllocated;
+#else
+    return 0;
+#endif
+}
+
+u16 MEM_getWorstFragmentation()
+{
+#if (MEM_TRACKING != 0)
+    return worstFragmentation;
+#else
+    return 0;
+#endif
+}
+
+void MEM_resetStats()
+{
+#if (MEM_TRACKING != 0)
+    peakAllocated = allocated;
+    worstFragmentation = 0;
+#endif
+}
+
+void MEM_sampleStats()
+{
+#if (MEM_TRACKING != 0)
+    const u16 frag = MEM_getFragmentation();
+
+    if (frag > worstFragmentation) worstFragmentation = frag;
+#endif
+}
+
+u16 MEM_checkpoint()
+{
+#if (MEM_TRACKING != 0)
+    return allocSerial;
+#else
+    return 0;
+#endif
+}
+
+u16 MEM_reportLeaks(u16 from, u16 to)
+{
+#if (MEM_TRACKING != 0)
+    char str[64];
+    MemTrackEntry *entry;
+    const u16 range = to - from;
+    u16 num;
+    u16 i;
+
+    KLog_U2("MEM_reportLeaks: from ", from, " to ", to);
+
+    num = 0;
+    entry = trackTable;
+    i = MEM_TRACK_SIZE;
+    while(i--)
+    {
+        // allocated between the 2 checkpoints ? (handle serial wrapping)
+        if (entry->ptr && ((u16) (entry->serial - from) < range))
+        {
+            sprintf(str, "MEML %u %u %u %06lX %06lX", entry->serial, entry->size, entry->tag, (u32) entry->ptr, (u32) entry->site);
+            KLog(str);
+            num++;
+        }
+
+        entry++;
+    }
+
+    KLog_U1("MEM_reportLeaks: leaked blocks = ", num);
+
+    return num;
+#else
+    return 0;
+#endif
 }
 
+bool MEM_createArena(MemArena *arena, u16 size)
+{
+    // 2 bytes aligned
+    size = (size + 1) & 0xFFFE;
+
+    arena->start = MEM_alloc(size);
+    arena->end = arena->start ? (arena->start + size) : NULL;
+    arena->current = arena->start;
+
+    if (!arena->start)
+    {
+#if (LIB_LOG_LEVEL >= LOG_LEVEL_ERROR)
+        KLog_U1("MEM_createArena(..) failed: can't allocate arena of size ", size);
+#endif
+
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+void MEM_releaseArena(MemArena *arena)
+{
+    // release arena memory block
+    MEM_free(arena->start);
+    arena->start = NULL;
+    arena->end = NULL;
+    arena->current = NULL;
+}
+
+void MEM_clearArena(MemArena *arena)
+{
+    arena->current = arena->start;
+}
+
+u16 MEM_getArenaFree(MemArena *arena)
+{
+    return arena->end - arena->current;
+}
+
+u16 MEM_getArenaAllocated(MemArena *arena)
+{
+    return arena->current - arena->start;
+}
+
+void* MEM_allocArena(MemArena *arena, u16 size)
+{
+    u8* result = arena->current;
+
+    if (size == 0)
+        return NULL;
+
+    // 2 bytes aligned
+    size = (size + 1) & 0xFFFE;
+
+    if (size > (u16) (arena->end - result))
+    {
+#if (LIB_LOG_LEVEL >= LOG_LEVEL_ERROR)
+        KLog_U2("MEM_allocArena(..) failed: no enough memory in arena, requested = ", size, " free = ", MEM_getArenaFree(arena));
+#endif
+
+        return NULL;
+    }
+
+    arena->current = result + size;
+
+    return result;
+}
+
+bool MEM_setFrameArenaSize(u16 size)
+{
+    // release previous one
+    if (frameArena.start) MEM_releaseArena(&frameArena);
+
+    if (size == 0) return TRUE;
+
+    return MEM_createArena(&frameArena, size);
+}
+
+void* MEM_allocFrame(u16 size)
+{
+    return MEM_allocArena(&frameArena, size);
+}
+
+void MEM_clearFrameArena()
+{
+    frameArena.current = frameArena.start;
+}
+
+bool MEM_createPool(MemPool *pool, u16 size, u16 num)
+{
+    u32 total;
+
+    // 2 bytes aligned
+    size = (size + 1) & 0xFFFE;
+    // bank + slots + slot index + slot position in a single block
+    total = (u32) num * (size + sizeof(void*) + sizeof(u16) + sizeof(u16));
+
+    pool->bank = (total <= 0xFFF0) ? MEM_alloc(total) : NULL;
+
+    if (!pool->bank)
+    {
+#if (LIB_LOG_LEVEL >= LOG_LEVEL_ERROR)
+        KLog_U2("MEM_createPool(..) failed: can't allocate pool of ", num, " objects of size ", size);
+#endif
+
+        pool->slots = NULL;
+        pool->slotIndex = NULL;
+        pool->slotPos = NULL;
+        pool->size = 0;
+        pool->num = 0;
+        pool->numLive = 0;
+        pool->peak = 0;
+
+        return FALSE;
+    }
+
+    pool->slots = (void**) (pool->bank + (num * size));
+    pool->slotIndex = (u16*) (pool->slots + num);
+    pool->slotPos = pool->slotIndex + num;
+    pool->size = size;
+    pool->num = num;
+
+    MEM_clearPool(pool);
+
+    return TRUE;
+}
+
+void MEM_releasePool(MemPool *pool)
+{
+    // release bank (single block)
+    MEM_free(pool->bank);
+    pool->bank = NULL;
+    pool->slots = NULL;
+    pool->slotIndex = NULL;
+    pool->slotPos = NULL;
+    pool->num = 0;
+    pool->numLive = 0;
+}
+
+void MEM_clearPool(MemPool *pool)
+{
+    u8 *obj = pool->bank;
+    void **slot = pool->slots;
+    u16 i;
+
+    // all objects free, in bank order
+    for(i = 0; i < pool->num; i++)
+    {
+        *slot++ = obj;
+        pool->slotIndex[i] = i;
+        pool->slotPos[i] = i;
+        obj += pool->size;
+    }
+
+    pool->numLive = 0;
+    pool->peak = 0;
+}
+
+void* MEM_allocPool(MemPool *pool)
+{
+    const u16 live = pool->numLive;
+
+    // no more free object
+    if (live >= pool->num) return NULL;
+
+    pool->numLive = live + 1;
+    if (live >= pool->peak) pool->peak = live + 1;
+
+    // first free slot
+    return pool->slots[live];
+}
+
+void MEM_freePool(MemPool *pool, void *obj)
+{
+    const u16 ind = MEM_getPoolIndex(pool, obj);
+    u16 pos;
+    u16 last;
+    u16 lastInd;
+
+#if (LIB_LOG_LEVEL >= LOG_LEVEL_ERROR)
+    // check index first (slot position can't be read for an object outside the pool)
+    if (ind >= pool->num)
+    {
+        KLog_U1("MEM_freePool(..) failed: object not allocated from this pool, index = ", ind);
+        return;
+    }
+#endif
+
+    pos = pool->slotPos[ind];
+
+#if (LIB_LOG_LEVEL >= LOG_LEVEL_ERROR)
+    if (pos >= pool->numLive)
+    {
+        KLog_U1("MEM_freePool(..) failed: object is not allocated, index = ", ind);
+        return;
+    }
+#endif
+
+    // last live slot
+    last = --pool->numLive;
+    lastInd = pool->slotIndex[last];
+
+    // move last live object into the released slot
+    pool->slots[pos] = pool->slots[last];
+    pool->slotIndex[pos] = lastInd;
+    pool->slotPos[lastInd] = pos;
+    // released object becomes the first free slot
+    pool->slots[last] = obj;
+    pool->slotIndex[last] = ind;
+    pool->slotPos[ind] = last;
+}
+
+void** MEM_getPoolLive(MemPool *pool)
+{
+    return pool->slots;
+}
+
+u16 MEM_getPoolNumLive(MemPool *pool)
+{
+    return pool->numLive;
+}
+
+u16 MEM_getPoolFree(MemPool *pool)
+{
+    return pool->num - pool->numLive;
+}
+
+u16 MEM_getPoolPeak(MemPool *pool)
+{
+    return pool->peak;
+}
+
+u16 MEM_getPoolIndex(MemPool *pool, void *obj)
+{
+    return (u16) ((u8*) obj - pool->bank) / pool->size;
+}
+
+#if (MEM_TRACKING != 0)
+
+static void trackAlloc(void *ptr, u16 size, void *site)
+{
+    MemTrackEntry *entry;
+    // heap block size
+    const u16 bsize = ((u16*) ptr)[-1] & ~USED;
+    u16 i;
+
+    allocated += bsize;
+    if (allocated > peakAllocated) peakAllocated = allocated;
+    tagAllocated[currentTag] += bsize;
+
+    // find a free entry
+    entry = trackTable;
+    i = MEM_TRACK_SIZE;
+    while(i--)
+    {
+        if (entry->ptr == NULL)
+        {
+            entry->ptr = ptr;
+            entry->site = site;
+            entry->size = size;
+            entry->tag = currentTag;
+            entry->serial = allocSerial++;
+            return;
+        }
+
+        entry++;
+    }
+
+    // table is full
+    trackLost++;
+    allocSerial++;
+}
+
+static void trackFree(void *ptr)
+{
+    MemTrackEntry *entry;
+    const u16 bsize = ((u16*) ptr)[-1] & ~USED;
+    u16 i;
+
+    allocated -= bsize;
+
+    entry = trackTable;
+    i = MEM_TRACK_SIZE;
+    while(i--)
+    {
+        if (entry->ptr == ptr)
+        {
+            tagAllocated[entry->tag] -= bsize;
+            entry->ptr = NULL;
+            return;
+        }
+
+        entry++;
+    }
+
+    // untracked allocation --> we don't know its tag, assume current one
+    if (tagAllocated[currentTag] >= bsize) tagAllocated[currentTag] -= bsize;
+}
+
+#endif
+
+/*
+ * Give all blocks of small free lists back to heap.
+ */
+static void releaseSmall()
+{
+    u16 i;
+
+    for(i = 0; i < SMALL_NUM; i++)
+    {
+        u16* b = smallList[i];
+
+        while(b)
+        {
+            u16* next = SMALL_NEXT(b);
+
+            // mark block as no more used
+            *b &= ~USED;
+            b = next;
+        }
+
+        smallList[i] = NULL;
+    }
+
+    smallCached = 0;
+}
+
+#if (LIB_LOG_LEVEL >= LOG_LEVEL_ERROR)
+
+/*
+ * Return TRUE if given block is in its size class free list.
+ */
+static bool isSmallCached(u16* b)
+{
+    const u16 bsize = *b & ~USED;
+    u16* p;
+
+    // not a small block
+    if (bsize > (SMALL_MAX + sizeof(u16))) return FALSE;
+
+    p = smallList[(bsize - (4 + sizeof(u16))) >> 2];
+
+    while(p)
+    {
+        if (p == b) return TRUE;
+        p = SMALL_NEXT(p);
+    }
+
+    return FALSE;
+}
+
+#endif
+
 /*
  * Pack free block and return first matching free block.
  */
@@ -470,6 +1184,9 @@ static u16* pack(u16 nsize)
     u16 *best;
     u16 bsize, psize;
 
+    // merged blocks may contain incremental packing position
+    packPos = heap;
+
     b = heap;
     best = b;
     bsize = 0;
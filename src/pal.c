@@ -328,7 +328,7 @@ void PAL_setPalette(u16 numPal, const u16* pal)
 
 void PAL_setColorsDMA(u16 index, const u16* pal, u16 count)
 {
-    DMA_queueDma(DMA_CRAM, (void*) pal, index * 2, count, 2);
+    DMA_queueDmaEx(DMA_CRAM, (void*) pal, index * 2, count, 2, DMA_LANE_CRITICAL);
 }
 
 void PAL_setPaletteColorsDMA(u16 index, const Palette* pal)
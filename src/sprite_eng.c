@@ -23,6 +23,14 @@
 // first hardware sprite is reserved (used internally for sorting)
 #define MAX_SPRITE                          (80 - 1)
 
+// number of 8 lines band for multiplexing scanline budget (240 lines max)
+#define MULTIPLEX_NUM_BAND                  (240 / 8)
+
+// alternative cutting: free hardware sprites under which we consider being short of them
+#define ALT_CUTTING_SLOT_MARGIN             8
+// alternative cutting: number of update without pressure before switching back to base cutting
+#define ALT_CUTTING_RELEASE_DELAY           60
+
 // internals
 #define VISIBILITY_ON                       0xFFFF
 #define VISIBILITY_OFF                      0x0000
@@ -36,8 +44,32 @@
 #define NEED_VISIBILITY_UPDATE              0x0010
 #define NEED_FRAME_UPDATE                   0x0020
 #define NEED_TILES_UPLOAD                   0x0040
+// frame update deferred (sprite is in the deferred frame update list)
+#define DEFERRED_FRAME_UPDATE               0x0008
+
+#define NEED_UPDATE                         (NEED_ST_ALL_UPDATE | DEFERRED_FRAME_UPDATE | NEED_VISIBILITY_UPDATE | NEED_FRAME_UPDATE | NEED_TILES_UPLOAD)
+
+// sprite is far from screen (hidden and ignored by SPR_update())
+#define FAR_CULLED                          0x0004
+
+// mark sprite as requiring process on next SPR_update()
+#define SET_HOT(sprite)                     hotBank[(sprite)->index] = TRUE
+
+// animation start tick so the given sequence step starts now (global animation tick mode)
+#define ANIM_START(anim, seq)               ((anim)->duration?(animTick - (anim)->timeline[seq]):animTick)
+
+// extend the dirty span of VDP sprite table with given VDP sprite
+#define SET_SAT_DIRTY(vdpSpr)               { if ((vdpSpr) < satDirtyFirst) satDirtyFirst = (vdpSpr); if ((vdpSpr) > satDirtyLast) satDirtyLast = (vdpSpr); }
+
 
-#define NEED_UPDATE                         0x00FF
+// shared tiles cache entry (tiles of an animation frame used by several sprites)
+typedef struct
+{
+    const TileSet* tileset;
+    u16 vramIndex;
+    u16 refCount;
+    u16 loaded;
+} SharedTiles;
 
 
 // shared from vdp_spr.c unit
@@ -50,12 +82,21 @@ extern void updateUserTileMaxIndex();
 static Sprite* allocateSprite(u16 head);
 //static Sprite** allocateSprites(Sprite** sprites, u16 num);
 static bool releaseSprite(Sprite* sprite);
-//static void releaseSprites(Sprite** sprites, u16 num);
+static void releaseSprites(Sprite** sprites, u16 num);
+static void releaseSpriteResources(Sprite* sprite);
+static u16 getAddFlag(u16 flag);
 
 static void setVDPSpriteIndex(Sprite* sprite, u16 ind, u16 num);
 static bool updateVisibility(Sprite* sprite, u16 status);
 static u16 setVisibility(Sprite* sprite, u16 visibility);
 static u16 updateFrame(Sprite* sprite, u16 status);
+static u16 deferFrameUpdate(Sprite* sprite, u16 status);
+static bool isFar(Sprite* sprite);
+static void setFar(Sprite* sprite);
+static void updateTimeline(Sprite* sprite);
+static void setPosition(Sprite* sprite, s16 x, s16 y);
+static void relocateTiles(u16 from, u16 to, u16 size);
+static void removeDeferredFrameUpdate(Sprite* sprite);
 
 static void updateSpriteTableAll(Sprite* sprite);
 static void updateSpriteTablePos(Sprite* sprite);
@@ -63,6 +104,17 @@ static void updateSpriteTableAttr(Sprite* sprite);
 static void loadTiles(Sprite* sprite);
 static Sprite* sortSprite(Sprite* sprite);
 static void moveAfter(Sprite* pos, Sprite* sprite);
+static void sortSprites();
+static void setAllSATDirty();
+static void clearSATDirty();
+static u16 getSATTransferSize();
+static void multiplexSprites();
+static bool allocateSharedTiles();
+static SharedTiles* findSharedTiles(const TileSet* tileset);
+static SharedTiles* acquireSharedTiles(const TileSet* tileset);
+static void releaseSharedTiles(SharedTiles* entry);
+static bool multiplexFit(Sprite* sprite, u16 lineMax, u16 dotMax);
+static void setAltCutting(bool value);
 static u16 getSpriteIndex(Sprite* sprite);
 static void logSprite(Sprite* sprite);
 
@@ -72,15 +124,87 @@ static VDPSprite* starter;
 // allocated bank of sprites for the Sprite Engine
 static Sprite* spritesBank = NULL;
 
-// used for sprite allocation
-static Sprite** allocStack;
-// point on top of the allocation stack (first available sprite)
-static Sprite** free;
+// hot state of each sprite of the bank (not zero = sprite need to be processed in SPR_update())
+static u16* hotBank = NULL;
+// position after the highest allocated sprite in the bank (scan limit for SPR_update())
+static u16 bankEnd;
+
+// dirty span of the VDP sprite table (first > last means nothing to upload)
+static VDPSprite* satDirtyFirst;
+static VDPSprite* satDirtyLast;
+
+// sprites waiting for tiles upload (done after sprite table is queued)
+static Sprite** tilesUploadList = NULL;
+// tiles DMA transfer size (in bytes) already reserved for this frame but not yet queued
+static u16 reservedTransferSize;
+
+// shared tiles cache (live entries can't exceed number of sprites as each sprite uses at most one entry), allocated
+// on first use of SPR_FLAG_SHARED_TILES
+static SharedTiles* sharedTiles = NULL;
+// position after the highest used entry of the shared tiles cache
+static u16 sharedEnd;
+// shared tiles entry used by each sprite of the bank (parallel to sprites bank)
+static SharedTiles** sharedBank = NULL;
+
+// tiles upload budget (in bytes) for frame updates between 2 SPR_update() calls (0 = no budget)
+static u16 tileUploadBudget;
+// tiles data (in bytes) required by frame updates since last SPR_update()
+static u16 tileUploadSize;
+// sprites for which frame update has been deferred (oldest first)
+static Sprite** deferredList = NULL;
+static u16 deferredNum;
+// deferred frame update counters (last update and total)
+static u16 deferredLast;
+static u16 deferredCount;
+static u32 deferredTotal;
+
+// runtime statistics (counters for current frame and history ring buffer)
+static SpriteFrameStats stats;
+static SpriteFrameStats statsHistory[SPR_STATS_HISTORY];
+static u16 statsPos;
+static u16 statsNum;
+static bool statsEnabled;
+
+// far culling margin in pixel (0 = far culling disabled)
+static u16 cullMargin;
+// global animation tick (incremented on each SPR_update(), elapsed ticks are computed modulo 65536)
+static u16 animTick;
+// automatic incremental VRAM defragmentation (largest free block threshold and tiles per frame)
+static u16 defragThreshold;
+static u16 defragMaxTile;
+
+// used for sprite allocation (objects bank is spritesBank)
+static MemPool spritePool;
 
 // pointer on first and last active sprite in the linked list
 Sprite* firstSprite;
 Sprite* lastSprite;
 
+// Sprite Engine init flag
+static u16 initFlag;
+// sprite list need to be sorted (deferred sort)
+static bool needSort;
+// sort buffers (2 x bankSize entries, allocated only for deferred sort)
+static Sprite** sortBuffer = NULL;
+// number of sprite in the bank (MAX_SPRITE or SPR_MULTIPLEX_MAX_SPRITE)
+static u16 bankSize;
+
+// multiplexing: visible sprites list (allocated only for multiplexing)
+static Sprite** multiplexList = NULL;
+// multiplexing: sprite (bank index) to start sprite selection from (rotated to give priority to dropped sprites) and its last list position
+static u16 multiplexStart;
+static u16 multiplexStartPos;
+// multiplexing: number of sprite dropped on last update
+static u16 multiplexDropped;
+// multiplexing: number of VDP sprite and pixel used per 8 lines band
+static u8 bandCount[MULTIPLEX_NUM_BAND];
+static u16 bandDots[MULTIPLEX_NUM_BAND];
+// multiplexing: sprites don't own VDP sprites, links are written here (VDP sprite table is rebuilt on each update)
+static VDPSprite dummyVDPSprite;
+// alternative cutting in use and number of update without hardware sprite pressure
+static bool altCutting;
+static u16 altCalm;
+
 // VRAM region allocated for the Sprite Engine
 static VRAMRegion vram;
 
@@ -109,23 +233,93 @@ u16 spriteVramSize = 0;
 #define PROFIL_LOADTILES                17
 #define PROFIL_SORT                     18
 #define PROFIL_VRAM_DEFRAG              19
+#define PROFIL_MULTIPLEX                20
 
-static u32 profil_time[20];
+static u32 profil_time[21];
 #endif
 
 
 void SPR_initEx(u16 vramSize)
+{
+    SPR_initEx2(vramSize, 0);
+}
+
+void SPR_initEx2(u16 vramSize, u16 flag)
 {
     u16 index;
     u16 size;
+    u16 prevTag;
 
     // already initialized --> end it first
     if (SPR_isInitialized()) SPR_end();
 
+    // multiplexing allows more sprites than hardware sprites
+    if (flag & SPR_INIT_FLAG_MULTIPLEX) bankSize = SPR_MULTIPLEX_MAX_SPRITE;
+    else bankSize = MAX_SPRITE;
+
+    // sprite engine allocations tag (heap instrumentation)
+    prevTag = MEM_setTag(MEM_TAG_SPRITE);
+
     // alloc sprites bank
-    spritesBank = MEM_alloc(MAX_SPRITE * sizeof(Sprite));
-    // allocation stack
-    allocStack = MEM_alloc(MAX_SPRITE * sizeof(Sprite*));
+    if (!MEM_createPool(&spritePool, sizeof(Sprite), bankSize))
+    {
+#if (LIB_LOG_LEVEL >= LOG_LEVEL_ERROR)
+        KLog("SPR_initEx2: failed - can't allocate sprites bank !");
+#endif
+
+        MEM_setTag(prevTag);
+        // stay uninitialized
+        spritesBank = NULL;
+        return;
+    }
+    spritesBank = (Sprite*) spritePool.bank;
+    // hot state (parallel to sprites bank)
+    hotBank = MEM_alloc(bankSize * sizeof(u16));
+    // pending tiles upload list
+    tilesUploadList = MEM_alloc(bankSize * sizeof(Sprite*));
+    // deferred frame update list
+    deferredList = MEM_alloc(bankSize * sizeof(Sprite*));
+    // sort buffers
+    if (flag & SPR_INIT_FLAG_DEFERRED_SORT)
+        sortBuffer = MEM_alloc(bankSize * 2 * sizeof(Sprite*));
+    // multiplexing list
+    if (flag & SPR_INIT_FLAG_MULTIPLEX)
+        multiplexList = MEM_alloc(bankSize * sizeof(Sprite*));
+
+    MEM_setTag(prevTag);
+
+    // any allocation failed ? --> release everything and stay uninitialized
+    if (!hotBank || !tilesUploadList || !deferredList ||
+        ((flag & SPR_INIT_FLAG_DEFERRED_SORT) && !sortBuffer) || ((flag & SPR_INIT_FLAG_MULTIPLEX) && !multiplexList))
+    {
+#if (LIB_LOG_LEVEL >= LOG_LEVEL_ERROR)
+        KLog("SPR_initEx2: failed - not enough memory !");
+#endif
+
+        MEM_releasePool(&spritePool);
+        spritesBank = NULL;
+        MEM_free(hotBank);
+        hotBank = NULL;
+        MEM_free(tilesUploadList);
+        tilesUploadList = NULL;
+        MEM_free(deferredList);
+        deferredList = NULL;
+        MEM_free(sortBuffer);
+        sortBuffer = NULL;
+        MEM_free(multiplexList);
+        multiplexList = NULL;
+
+        return;
+    }
+
+    initFlag = flag;
+    // no tiles upload budget by default
+    tileUploadBudget = 0;
+    // no far culling by default
+    cullMargin = 0;
+    // no automatic VRAM defragmentation by default
+    defragThreshold = 0;
+    defragMaxTile = 0;
 
     size = vramSize?vramSize:420;
     // get start tile index for sprite data (reserve VRAM area just before system font)
@@ -162,10 +356,31 @@ void SPR_end()
         VDP_updateSprites(1, DMA_QUEUE_COPY);
 
         // release memory
-        MEM_free(spritesBank);
+        MEM_releasePool(&spritePool);
         spritesBank = NULL;
-        MEM_free(allocStack);
-        allocStack = NULL;
+        MEM_free(hotBank);
+        hotBank = NULL;
+        MEM_free(tilesUploadList);
+        tilesUploadList = NULL;
+        MEM_free(deferredList);
+        deferredList = NULL;
+        if (sharedTiles)
+        {
+            MEM_free(sharedTiles);
+            sharedTiles = NULL;
+            MEM_free(sharedBank);
+            sharedBank = NULL;
+        }
+        if (sortBuffer)
+        {
+            MEM_free(sortBuffer);
+            sortBuffer = NULL;
+        }
+        if (multiplexList)
+        {
+            MEM_free(multiplexList);
+            multiplexList = NULL;
+        }
 
         VRAM_releaseRegion(&vram);
         spriteVramSize = 0;
@@ -192,17 +407,39 @@ void SPR_reset()
     u16 i;
 
     // release and clear sprites data
-    memset(spritesBank, 0, sizeof(Sprite) * MAX_SPRITE);
-
-    // reset allocation stack
-    for(i = 0; i < MAX_SPRITE; i++)
-        allocStack[i] = &spritesBank[i];
-    // init free position
-    free = &allocStack[MAX_SPRITE];
+    memset(spritesBank, 0, sizeof(Sprite) * bankSize);
+    memset(hotBank, 0, sizeof(u16) * bankSize);
+    if (sharedTiles)
+    {
+        memset(sharedTiles, 0, sizeof(SharedTiles) * bankSize);
+        memset(sharedBank, 0, sizeof(SharedTiles*) * bankSize);
+    }
+    sharedEnd = 0;
+    // reset runtime statistics
+    memset(&stats, 0, sizeof(stats));
+    statsPos = 0;
+    statsNum = 0;
+    // reset global animation tick
+    animTick = 0;
+    // no deferred frame update
+    deferredNum = 0;
+    deferredLast = 0;
+    deferredCount = 0;
+    deferredTotal = 0;
+    tileUploadSize = 0;
+
+    // set sprites index
+    for(i = 0; i < bankSize; i++) spritesBank[i].index = i;
+    // reset allocation pool (first sprite of the bank allocated first so we keep used sprites packed at bank start)
+    MEM_clearPool(&spritePool);
+    // no sprite to scan
+    bankEnd = 0;
 
     // no active sprites
     firstSprite = NULL;
     lastSprite = NULL;
+    // nothing to sort
+    needSort = FALSE;
 
     // clear VRAM region
     VRAM_clearRegion(&vram);
@@ -214,6 +451,23 @@ void SPR_reset()
     // hide it
     starter->y = 0;
 
+    // multiplexing ? --> we reserve all VDP sprites, sprite table is rebuilt on each update
+    if (initFlag & SPR_INIT_FLAG_MULTIPLEX)
+    {
+        VDP_allocateSprites(VDP_getAvailableSprites());
+        // no start sprite
+        multiplexStart = 0xFFFF;
+        multiplexStartPos = 0;
+        multiplexDropped = 0;
+    }
+    // base cutting by default
+    altCutting = FALSE;
+    altCalm = 0;
+
+    // need to upload the whole sprite table
+    setAllSATDirty();
+    reservedTransferSize = 0;
+
 #ifdef SPR_PROFIL
     memset(profil_time, 0, sizeof(profil_time));
 #endif // SPR_PROFIL
@@ -230,8 +484,11 @@ static Sprite* allocateSprite(u16 head)
 {
     Sprite* result;
 
+    // allocate
+    result = MEM_allocPool(&spritePool);
+
     // enough sprite remaining ?
-    if (free == allocStack)
+    if (result == NULL)
     {
 #if (LIB_LOG_LEVEL >= LOG_LEVEL_ERROR)
         KLog("SPR_internalAllocateSprite(): failed - no more available sprite !");
@@ -241,11 +498,11 @@ static Sprite* allocateSprite(u16 head)
     }
 
 #if (LIB_LOG_LEVEL >= LOG_LEVEL_INFO)
-    KLog_U1("SPR_internalAllocateSprite(): success - allocating sprite at pos ", free[-1] - spritesBank);
+    KLog_U1("SPR_internalAllocateSprite(): success - allocating sprite at pos ", result - spritesBank);
 #endif // LIB_DEBUG
 
-    // allocate
-    result = *--free;
+    // update scan limit
+    if (result->index >= bankEnd) bankEnd = result->index + 1;
 
     if (head)
     {
@@ -292,7 +549,11 @@ static bool releaseSprite(Sprite* sprite)
 #endif // LIB_DEBUG
 
         // release sprite
-        *free++ = sprite;
+        MEM_freePool(&spritePool, sprite);
+        // nothing more to process for this sprite
+        hotBank[sprite->index] = FALSE;
+        // remove from deferred frame update list
+        if (sprite->status & DEFERRED_FRAME_UPDATE) removeDeferredFrameUpdate(sprite);
 
         // remove sprite from chained list
         prev = sprite->prev;
@@ -322,9 +583,13 @@ static bool releaseSprite(Sprite* sprite)
             // update last sprite
             lastSprite = prev;
         }
+        // multiplexing uses a dummy VDP sprite (sprite table is rebuilt on each update)
+        if (!(initFlag & SPR_INIT_FLAG_MULTIPLEX)) SET_SAT_DIRTY(lastVDPSprite);
 
         // not anymore allocated
         sprite->status &= ~ALLOCATED;
+        // update scan limit (trim released sprites at end of bank)
+        while(bankEnd && !(spritesBank[bankEnd - 1].status & ALLOCATED)) bankEnd--;
 
 #ifdef SPR_PROFIL
         profil_time[PROFIL_RELEASE_SPRITE] += getSubTick() - prof;
@@ -344,6 +609,152 @@ static bool releaseSprite(Sprite* sprite)
     return FALSE;
 }
 
+static void releaseSprites(Sprite** sprites, u16 num)
+{
+#ifdef SPR_PROFIL
+    s32 prof = getSubTick();
+#endif // SPR_PROFIL
+
+    Sprite** spr;
+    Sprite* sprite;
+    Sprite* prev;
+    Sprite* next;
+    VDPSprite* lastVDPSprite;
+    u16 i;
+
+    // first pass: remove all sprites from the chained list (VDP sprite links are fixed afterward)
+    spr = sprites;
+    i = num;
+    while(i--)
+    {
+        sprite = *spr++;
+
+        // ignore NULL and not allocated sprites
+        if (!sprite || !(sprite->status & ALLOCATED)) continue;
+
+        // release sprite
+        MEM_freePool(&spritePool, sprite);
+        // nothing more to process for this sprite
+        hotBank[sprite->index] = FALSE;
+        // remove from deferred frame update list
+        if (sprite->status & DEFERRED_FRAME_UPDATE) removeDeferredFrameUpdate(sprite);
+
+        prev = sprite->prev;
+        next = sprite->next;
+
+        if (prev) prev->next = next;
+        // update first sprite
+        else firstSprite = next;
+        if (next) next->prev = prev;
+        // update last sprite
+        else lastSprite = prev;
+
+        // not anymore allocated
+        sprite->status &= ~ALLOCATED;
+
+        releaseSpriteResources(sprite);
+    }
+
+    // update scan limit (trim released sprites at end of bank)
+    while(bankEnd && !(spritesBank[bankEnd - 1].status & ALLOCATED)) bankEnd--;
+
+    // multiplexing ? --> VDP sprite links are rebuilt on each update
+    if (initFlag & SPR_INIT_FLAG_MULTIPLEX)
+    {
+#ifdef SPR_PROFIL
+        profil_time[PROFIL_RELEASE_SPRITE] += getSubTick() - prof;
+#endif // SPR_PROFIL
+
+        return;
+    }
+
+    // second pass: link each remaining sprite located before a released one to its new next sprite
+    spr = sprites;
+    i = num;
+    while(i--)
+    {
+        sprite = *spr++;
+
+        if (!sprite) continue;
+
+        // find previous remaining sprite (previous sprite may have been released in the same pass)
+        prev = sprite->prev;
+        while(prev && !(prev->status & ALLOCATED)) prev = prev->prev;
+
+        if (prev)
+        {
+            lastVDPSprite = prev->lastVDPSprite;
+            next = prev->next;
+        }
+        else
+        {
+            lastVDPSprite = starter;
+            next = firstSprite;
+        }
+
+        lastVDPSprite->link = next?next->VDPSpriteIndex:0;
+        SET_SAT_DIRTY(lastVDPSprite);
+    }
+
+#ifdef SPR_PROFIL
+    profil_time[PROFIL_RELEASE_SPRITE] += getSubTick() - prof;
+#endif // SPR_PROFIL
+}
+
+static void releaseSpriteResources(Sprite* sprite)
+{
+    const u16 status = sprite->status;
+
+    // auto VDP sprite alloc enabled --> release VDP sprite(s)
+    if (status & SPR_FLAG_AUTO_SPRITE_ALLOC)
+    {
+        VDP_releaseSprites(sprite->VDPSpriteIndex, sprite->definition->maxNumSprite);
+
+#ifdef SPR_DEBUG
+        KLog_U3("  released ", sprite->definition->maxNumSprite, " VDP sprite(s) at ", sprite->VDPSpriteIndex, ", remaining VDP sprite = ", VDP_getAvailableSprites());
+#endif // SPR_DEBUG
+    }
+    // auto VRAM alloc enabled --> release VRAM area allocated for this sprite
+    if (status & SPR_FLAG_AUTO_VRAM_ALLOC)
+    {
+        VRAM_free(&vram, sprite->attribut & TILE_INDEX_MASK);
+
+#ifdef SPR_DEBUG
+        KLog_U3("  released ", sprite->definition->maxNumTile, " tiles in VRAM at ", sprite->attribut & TILE_INDEX_MASK, ", remaining VRAM: ", VRAM_getFree(&vram));
+#endif // SPR_DEBUG
+    }
+    // shared tiles --> release our reference on current frame tiles
+    if (status & SPR_FLAG_SHARED_TILES)
+    {
+        SharedTiles** ref = &sharedBank[sprite->index];
+
+        if (*ref)
+        {
+            releaseSharedTiles(*ref);
+            *ref = NULL;
+        }
+    }
+}
+
+static u16 getAddFlag(u16 flag)
+{
+    u16 result = flag;
+
+    // multiplexed sprites don't own VDP sprites
+    if (initFlag & SPR_INIT_FLAG_MULTIPLEX) result &= ~SPR_FLAG_AUTO_SPRITE_ALLOC;
+    // shared tiles cache not yet allocated and not enough memory ? --> use own VRAM tiles instead
+    if ((result & SPR_FLAG_SHARED_TILES) && !sharedTiles && !allocateSharedTiles())
+        result = (result & ~SPR_FLAG_SHARED_TILES) | SPR_FLAG_AUTO_VRAM_ALLOC | SPR_FLAG_AUTO_TILE_UPLOAD;
+    // shared tiles replace auto VRAM allocation (VRAM is allocated per frame on frame update)
+    if (result & SPR_FLAG_SHARED_TILES)
+    {
+        result &= ~SPR_FLAG_AUTO_VRAM_ALLOC;
+        result |= SPR_FLAG_AUTO_TILE_UPLOAD;
+    }
+
+    return result;
+}
+
 Sprite* SPR_addSpriteEx(const SpriteDefinition* spriteDef, s16 x, s16 y, u16 attribut, u16 spriteIndex, u16 flag)
 {
 #ifdef SPR_PROFIL
@@ -353,6 +764,8 @@ Sprite* SPR_addSpriteEx(const SpriteDefinition* spriteDef, s16 x, s16 y, u16 att
     s16 ind;
     Sprite* sprite;
 
+    flag = getAddFlag(flag);
+
     // allocate new sprite
     sprite = allocateSprite(flag & SPR_FLAG_INSERT_HEAD);
 
@@ -452,6 +865,10 @@ Sprite* SPR_addSpriteEx(const SpriteDefinition* spriteDef, s16 x, s16 y, u16 att
     // set anim and frame to 0 (important to do it after sprite->attribut has been set)
     SPR_setAnimAndFrame(sprite, 0, 0);
 
+    // far culling enabled and sprite added far from screen ? --> hide it now
+    if (cullMargin && (flag & SPR_FLAG_AUTO_VISIBILITY) && isFar(sprite))
+        setFar(sprite);
+
 #ifdef SPR_PROFIL
     profil_time[PROFIL_ADD_SPRITE] += getSubTick() - prof;
 #endif // SPR_PROFIL
@@ -465,6 +882,149 @@ Sprite* SPR_addSprite(const SpriteDefinition* spriteDef, s16 x, s16 y, u16 attri
                             SPR_FLAG_AUTO_VRAM_ALLOC | SPR_FLAG_AUTO_SPRITE_ALLOC | SPR_FLAG_AUTO_TILE_UPLOAD);
 }
 
+u16 SPR_addSprites(Sprite** sprites, const SpriteDefinition* spriteDef, const Vect2D_s16* positions, u16 num, u16 attribut, u16 flag)
+{
+#ifdef SPR_PROFIL
+    s32 prof = getSubTick();
+#endif // SPR_PROFIL
+
+    Sprite* first;
+    Sprite* last;
+    Sprite* sprite;
+    s16 ind;
+    u16 i;
+
+    flag = getAddFlag(flag);
+
+    Animation* animation = spriteDef->animations[0];
+    const u16 numVDPSprite = spriteDef->maxNumSprite;
+    const u16 head = flag & SPR_FLAG_INSERT_HEAD;
+    const u16 status = ALLOCATED | (flag & SPR_FLAG_MASK) | NEED_FRAME_UPDATE;
+    const u16 visibility = (flag & SPR_FLAG_AUTO_VISIBILITY)?0:VISIBILITY_ON;
+    const s16 depth = head?SPR_MIN_DEPTH:SPR_MAX_DEPTH;
+    const u16 timer = (initFlag & SPR_INIT_FLAG_GLOBAL_ANIM_TICK)?ANIM_START(animation, 0):0;
+
+    first = NULL;
+    // new sprites are chained after the current last sprite (or starter if inserted at head)
+    last = head?NULL:lastSprite;
+
+    // single pass: allocate and initialize new sprites, chaining them together (sprite and VDP sprite links)
+    for(i = 0; i < num; i++)
+    {
+        sprite = MEM_allocPool(&spritePool);
+        // can't allocate --> stop here
+        if (!sprite) break;
+
+        // auto VDP sprite alloc enabled ?
+        if (flag & SPR_FLAG_AUTO_SPRITE_ALLOC)
+        {
+            ind = VDP_allocateSprites(numVDPSprite);
+            // not enough --> release sprite and stop here
+            if (ind == -1)
+            {
+                MEM_freePool(&spritePool, sprite);
+                break;
+            }
+        }
+        else ind = 0;
+
+        // auto VRAM alloc enabled ?
+        if (flag & SPR_FLAG_AUTO_VRAM_ALLOC)
+        {
+            const s16 tileInd = VRAM_alloc(&vram, spriteDef->maxNumTile);
+            // not enough --> release VDP sprites and sprite then stop here
+            if (tileInd < 0)
+            {
+                if (flag & SPR_FLAG_AUTO_SPRITE_ALLOC) VDP_releaseSprites(ind, numVDPSprite);
+                MEM_freePool(&spritePool, sprite);
+                break;
+            }
+
+            // set VRAM index and preserve specific attributs from parameter
+            sprite->attribut = tileInd | (attribut & TILE_ATTR_MASK);
+        }
+        // just use the given attribut
+        else sprite->attribut = attribut;
+
+        sprite->status = status;
+        sprite->visibility = visibility;
+        sprite->definition = spriteDef;
+        sprite->onFrameChange = NULL;
+        sprite->animation = animation;
+        sprite->frame = NULL;
+        sprite->frameInfo = NULL;
+        sprite->animInd = 0;
+        sprite->seqInd = 0;
+        sprite->frameInd = animation->sequence[0];
+        sprite->timer = timer;
+        sprite->x = positions->x + 0x80;
+        sprite->y = positions->y + 0x80;
+        sprite->depth = depth;
+        sprite->lastNumSprite = numVDPSprite;
+        sprite->spriteToHide = 0;
+
+        // chain to previous sprite (next link is set when the following sprite is chained)
+        sprite->prev = last;
+        sprite->next = NULL;
+        if (last) last->next = sprite;
+        if (!first) first = sprite;
+        last = sprite;
+
+        // set the VDP Sprite index (links previous VDP sprite to this one)
+        setVDPSpriteIndex(sprite, ind, numVDPSprite);
+
+        // update scan limit and mark as hot
+        if (sprite->index >= bankEnd) bankEnd = sprite->index + 1;
+        hotBank[sprite->index] = TRUE;
+
+        // far culling enabled and sprite added far from screen ? --> hide it now
+        if (cullMargin && (flag & SPR_FLAG_AUTO_VISIBILITY) && isFar(sprite))
+            setFar(sprite);
+
+        *sprites++ = sprite;
+        positions++;
+    }
+
+    // at least one sprite added ? --> insert the new chain at once
+    if (first)
+    {
+        if (head)
+        {
+            // current first sprite now follows the new chain
+            last->next = firstSprite;
+            if (firstSprite)
+            {
+                firstSprite->prev = last;
+
+                if (!(initFlag & SPR_INIT_FLAG_MULTIPLEX))
+                {
+                    last->lastVDPSprite->link = firstSprite->VDPSpriteIndex;
+                    SET_SAT_DIRTY(last->lastVDPSprite);
+                }
+            }
+            // update last sprite
+            else lastSprite = last;
+            firstSprite = first;
+        }
+        else
+        {
+            // update first sprite
+            if (!firstSprite) firstSprite = first;
+            lastSprite = last;
+        }
+    }
+
+#if (LIB_LOG_LEVEL >= LOG_LEVEL_ERROR)
+    if (i < num) KLog_U2("SPR_addSprites: failed - only ", i, " sprite(s) added on ", num);
+#endif // LIB_DEBUG
+
+#ifdef SPR_PROFIL
+    profil_time[PROFIL_ADD_SPRITE] += getSubTick() - prof;
+#endif // SPR_PROFIL
+
+    return i;
+}
+
 Sprite* SPR_addSpriteExSafe(const SpriteDefinition* spriteDef, s16 x, s16 y, u16 attribut, u16 spriteIndex, u16 flag)
 {
     Sprite* result = SPR_addSpriteEx(spriteDef, x, y, attribut, spriteIndex, flag);
@@ -507,36 +1067,21 @@ void SPR_releaseSprite(Sprite* sprite)
     KLog_U2("SPR_releaseSprite: releasing sprite #", getSpriteIndex(sprite), " - internal position = ", sprite - spritesBank);
 #endif // SPR_DEBUG
 
-    // release sprite
-    if (!releaseSprite(sprite))
-    {
+    // release sprite and its resources
+    if (releaseSprite(sprite)) releaseSpriteResources(sprite);
+
 #ifdef SPR_PROFIL
-        profil_time[PROFIL_REMOVE_SPRITE] += getSubTick() - prof;
+    profil_time[PROFIL_REMOVE_SPRITE] += getSubTick() - prof;
 #endif // SPR_PROFIL
+}
 
-        return;
-    }
-
-    u16 status = sprite->status;
-
-    // auto VDP sprite alloc enabled --> release VDP sprite(s)
-    if (status & SPR_FLAG_AUTO_SPRITE_ALLOC)
-    {
-        VDP_releaseSprites(sprite->VDPSpriteIndex, sprite->definition->maxNumSprite);
-
-#ifdef SPR_DEBUG
-        KLog_U3("  released ", sprite->definition->maxNumSprite, " VDP sprite(s) at ", sprite->VDPSpriteIndex, ", remaining VDP sprite = ", VDP_getAvailableSprites());
-#endif // SPR_DEBUG
-    }
-    // auto VRAM alloc enabled --> release VRAM area allocated for this sprite
-    if (status & SPR_FLAG_AUTO_VRAM_ALLOC)
-    {
-        VRAM_free(&vram, sprite->attribut & TILE_INDEX_MASK);
+void SPR_releaseSprites(Sprite** sprites, u16 num)
+{
+#ifdef SPR_PROFIL
+    s32 prof = getSubTick();
+#endif // SPR_PROFIL
 
-#ifdef SPR_DEBUG
-        KLog_U3("  released ", sprite->definition->maxNumTile, " tiles in VRAM at ", sprite->attribut & TILE_INDEX_MASK, ", remaining VRAM: ", VRAM_getFree(&vram));
-#endif // SPR_DEBUG
-    }
+    releaseSprites(sprites, num);
 
 #ifdef SPR_PROFIL
     profil_time[PROFIL_REMOVE_SPRITE] += getSubTick() - prof;
@@ -545,7 +1090,7 @@ void SPR_releaseSprite(Sprite* sprite)
 
 u16 SPR_getNumActiveSprite()
 {
-    return &allocStack[MAX_SPRITE] - free;
+    return MEM_getPoolNumLive(&spritePool);
 }
 
 void SPR_defragVRAM()
@@ -555,21 +1100,38 @@ void SPR_defragVRAM()
 #endif // SPR_PROFIL
 
     Sprite* sprite;
+    SharedTiles* entry;
+    u16 i;
 
     // release all VRAM region
     VRAM_clearRegion(&vram);
 
+    // re-allocate shared tiles first (need to be uploaded again)
+    entry = sharedTiles;
+    i = sharedEnd;
+    while(i--)
+    {
+        if (entry->refCount)
+        {
+            entry->vramIndex = VRAM_alloc(&vram, entry->tileset->numTile);
+            entry->loaded = FALSE;
+        }
+
+        entry++;
+    }
+
     // iterate over all sprites to re-allocate auto allocated VRAM
     sprite = firstSprite;
     while(sprite)
     {
         u16 status = sprite->status;
+        SharedTiles* shared = (status & SPR_FLAG_SHARED_TILES)?sharedBank[sprite->index]:NULL;
 
-        // sprite is using auto VRAM allocation ?
-        if (status & SPR_FLAG_AUTO_VRAM_ALLOC)
+        // sprite is using auto VRAM allocation or shared tiles ?
+        if ((status & SPR_FLAG_AUTO_VRAM_ALLOC) || shared)
         {
             // re-allocate VRAM for this sprite (can't fail here)
-            const u16 ind = VRAM_alloc(&vram, sprite->definition->maxNumTile);
+            const u16 ind = shared?shared->vramIndex:VRAM_alloc(&vram, sprite->definition->maxNumTile);
             const u16 attr = sprite->attribut;
 
             // VRAM allocation changed ?
@@ -585,6 +1147,7 @@ void SPR_defragVRAM()
                     status |= NEED_TILES_UPLOAD;
 
                 sprite->status = status;
+                SET_HOT(sprite);
             }
         }
 
@@ -597,6 +1160,40 @@ void SPR_defragVRAM()
 #endif // SPR_PROFIL
 }
 
+u16 SPR_defragVRAMStep(u16 maxTile)
+{
+#ifdef SPR_PROFIL
+    s32 prof = getSubTick();
+#endif // SPR_PROFIL
+
+    u16 moved = 0;
+
+    while(moved < maxTile)
+    {
+        u16 from, to;
+        const u16 remaining = maxTile - moved;
+        const u16 size = VRAM_compactStep(&vram, remaining, &from, &to);
+
+        // compacted or not enough budget left (block isn't moved then) --> done
+        if (!size || (size > remaining)) break;
+
+        relocateTiles(from, to, size);
+        moved += size;
+    }
+
+#ifdef SPR_PROFIL
+    profil_time[PROFIL_VRAM_DEFRAG] += getSubTick() - prof;
+#endif // SPR_PROFIL
+
+    return moved;
+}
+
+void SPR_setAutoDefragVRAM(u16 threshold, u16 maxTilePerFrame)
+{
+    defragThreshold = threshold;
+    defragMaxTile = maxTilePerFrame;
+}
+
 u16** SPR_loadAllFrames(const SpriteDefinition* sprDef, u16 index, u16* totalNumTile)
 {
     u16 numFrameTot = 0;
@@ -757,25 +1354,55 @@ void SPR_setPosition(Sprite* sprite, s16 x, s16 y)
     s32 prof = getSubTick();
 #endif // SPR_PROFIL
 
-    const s16 newx = x + 0x80;
-    const s16 newy = y + 0x80;
+    setPosition(sprite, x, y);
 
-#ifdef SPR_DEBUG
-    KLog_U3("SPR_setPosition: #", getSpriteIndex(sprite), "  X=", newx, " Y=", newy);
-#endif // SPR_DEBUG
+#ifdef SPR_PROFIL
+    profil_time[PROFIL_SET_ATTRIBUTE] += getSubTick() - prof;
+#endif // SPR_PROFIL
+}
 
-    if ((sprite->x != newx) || (sprite->y != newy))
+void SPR_setPositions(Sprite** sprites, const Vect2D_s16* positions, u16 num)
+{
+#ifdef SPR_PROFIL
+    s32 prof = getSubTick();
+#endif // SPR_PROFIL
+
+    // far culling enabled --> need full position processing
+    if (cullMargin)
     {
-        u16 status = sprite->status;
+        while(num--)
+        {
+            Sprite* sprite = *sprites++;
 
-        sprite->x = newx;
-        sprite->y = newy;
+            if (sprite) setPosition(sprite, positions->x, positions->y);
+            positions++;
+        }
+    }
+    else
+    {
+        while(num--)
+        {
+            Sprite* sprite = *sprites++;
+            const s16 newx = positions->x + 0x80;
+            const s16 newy = positions->y + 0x80;
 
-        // need to recompute visibility if auto visibility is enabled
-        if (status & SPR_FLAG_AUTO_VISIBILITY)
-            status |= NEED_VISIBILITY_UPDATE;
+            positions++;
 
-        sprite->status = status | NEED_ST_POS_UPDATE;
+            if (sprite && ((sprite->x != newx) || (sprite->y != newy)))
+            {
+                u16 status = sprite->status;
+
+                sprite->x = newx;
+                sprite->y = newy;
+
+                // need to recompute visibility if auto visibility is enabled
+                if (status & SPR_FLAG_AUTO_VISIBILITY)
+                    status |= NEED_VISIBILITY_UPDATE;
+
+                sprite->status = status | NEED_ST_POS_UPDATE;
+                SET_HOT(sprite);
+            }
+        }
     }
 
 #ifdef SPR_PROFIL
@@ -810,6 +1437,7 @@ void SPR_setHFlip(Sprite* sprite, u16 value)
 
             // need to also recompute complete VDP sprite table
             sprite->status = status | NEED_ST_ALL_UPDATE;
+            SET_HOT(sprite);
 
             // update attribut and frameInfo (depend from HV flip state)
             sprite->attribut = attr;
@@ -835,6 +1463,7 @@ void SPR_setHFlip(Sprite* sprite, u16 value)
 
             // need to also recompute complete VDP sprite table
             sprite->status = status | NEED_ST_ALL_UPDATE;
+            SET_HOT(sprite);
 
             // update attribut and frameInfo (depend from HV flip state)
             sprite->attribut = attr;
@@ -874,6 +1503,7 @@ void SPR_setVFlip(Sprite* sprite, u16 value)
 
             // need to also recompute complete VDP sprite table
             sprite->status = status | NEED_ST_ALL_UPDATE;
+            SET_HOT(sprite);
 
             // update attribut and frameInfo (depend from HV flip state)
             sprite->attribut = attr;
@@ -899,6 +1529,7 @@ void SPR_setVFlip(Sprite* sprite, u16 value)
 
             // need to also recompute complete VDP sprite table
             sprite->status = status | NEED_ST_ALL_UPDATE;
+            SET_HOT(sprite);
 
             // update attribut and frameInfo (depend from HV flip state)
             sprite->attribut = attr;
@@ -927,6 +1558,7 @@ void SPR_setPriorityAttribut(Sprite* sprite, u16 value)
         {
             sprite->attribut = oldAttribut & (~TILE_ATTR_PRIORITY_MASK);
             sprite->status |= NEED_ST_ATTR_UPDATE;
+            SET_HOT(sprite);
 
 #ifdef SPR_DEBUG
             KLog_U1_("SPR_setPriorityAttribut: #", getSpriteIndex(sprite), " removed priority");
@@ -940,6 +1572,7 @@ void SPR_setPriorityAttribut(Sprite* sprite, u16 value)
         {
             sprite->attribut = oldAttribut | TILE_ATTR_PRIORITY_MASK;
             sprite->status |= NEED_ST_ATTR_UPDATE;
+            SET_HOT(sprite);
 
 #ifdef SPR_DEBUG
             KLog_U1_("SPR_setPriorityAttribut: #", getSpriteIndex(sprite), " added priority");
@@ -966,6 +1599,7 @@ void SPR_setPalette(Sprite* sprite, u16 value)
         sprite->attribut = newAttribut;
         // need to update VDP sprite attribut field only
         sprite->status |= NEED_ST_ATTR_UPDATE;
+        SET_HOT(sprite);
 
 #ifdef SPR_DEBUG
         KLog_U2("SPR_setPalette: #", getSpriteIndex(sprite), " palette=", value);
@@ -990,9 +1624,12 @@ void SPR_setDepth(Sprite* sprite, s16 value)
     // depth changed ?
     if (sprite->depth != value)
     {
-        // set depth and sort sprite (need to be done immediately to get consistent sort)
         sprite->depth = value;
-        sortSprite(sprite);
+
+        // deferred sort ? --> whole list will be sorted on next SPR_update()
+        if (initFlag & SPR_INIT_FLAG_DEFERRED_SORT) needSort = TRUE;
+        // sort sprite (need to be done immediately to get consistent sort)
+        else sortSprite(sprite);
     }
 
 #ifdef SPR_PROFIL
@@ -1043,14 +1680,15 @@ void SPR_setAnimAndFrame(Sprite* sprite, s16 anim, s16 frame)
         sprite->animation = animation;
         sprite->frameInd = frameInd;
 
-        // set timer to 0 to prevent auto animation to change frame in between
-        sprite->timer = 0;
+        // set timer to 0 to prevent auto animation to change frame in between (global tick mode: animation starts from this frame now)
+        sprite->timer = (initFlag & SPR_INIT_FLAG_GLOBAL_ANIM_TICK)?ANIM_START(animation, frame):0;
 
 #ifdef SPR_DEBUG
         KLog_U4("SPR_setAnimAndFrame: #", getSpriteIndex(sprite), " anim=", anim, " frame=", frame, " adj frame=", frameInd);
 #endif // SPR_DEBUG
 
         sprite->status |= NEED_FRAME_UPDATE;
+        SET_HOT(sprite);
     }
 
 #ifdef SPR_PROFIL
@@ -1083,14 +1721,15 @@ void SPR_setAnim(Sprite* sprite, s16 anim)
         sprite->animation = animation;
         sprite->frameInd = frameInd;
 
-        // set timer to 0 to prevent auto animation to change frame in between
-        sprite->timer = 0;
+        // set timer to 0 to prevent auto animation to change frame in between (global tick mode: animation starts now)
+        sprite->timer = (initFlag & SPR_INIT_FLAG_GLOBAL_ANIM_TICK)?animTick:0;
 
 #ifdef SPR_DEBUG
         KLog_U3("SPR_setAnim: #", getSpriteIndex(sprite), " anim=", anim, " frame=0 adj frame=", frameInd);
 #endif // SPR_DEBUG
 
         sprite->status |= NEED_FRAME_UPDATE;
+        SET_HOT(sprite);
     }
 
 #ifdef SPR_PROFIL
@@ -1118,18 +1757,24 @@ void SPR_setFrame(Sprite* sprite, s16 frame)
 
         sprite->seqInd = frame;
 
+        // global tick mode --> animation starts from this frame now
+        if (initFlag & SPR_INIT_FLAG_GLOBAL_ANIM_TICK)
+            sprite->timer = ANIM_START(sprite->animation, frame);
+
         if (sprite->frameInd != frameInd)
         {
             sprite->frameInd = frameInd;
 
             // set timer to 0 to prevent auto animation to change frame in between
-            sprite->timer = 0;
+            if (!(initFlag & SPR_INIT_FLAG_GLOBAL_ANIM_TICK))
+                sprite->timer = 0;
 
 #ifdef SPR_DEBUG
             KLog_U3("SPR_setFrame: #", getSpriteIndex(sprite), "  frame=", frame, " adj frame=", frameInd);
 #endif // SPR_DEBUG
 
             sprite->status |= NEED_FRAME_UPDATE;
+            SET_HOT(sprite);
         }
     }
 
@@ -1168,7 +1813,35 @@ bool SPR_setVRAMTileIndex(Sprite* sprite, s16 value)
     u16 status = sprite->status;
     u16 oldAttribut = sprite->attribut;
 
-    if (status & SPR_FLAG_AUTO_VRAM_ALLOC)
+    if (status & SPR_FLAG_SHARED_TILES)
+    {
+        // pass to manual allocation
+        if (value != -1)
+        {
+            SharedTiles** ref = &sharedBank[sprite->index];
+
+            // remove shared tiles flag
+            status &= ~SPR_FLAG_SHARED_TILES;
+            // release shared tiles
+            if (*ref)
+            {
+                releaseSharedTiles(*ref);
+                *ref = NULL;
+            }
+            // set fixed VRAM index
+            newInd = value;
+        }
+        // nothing to do --> just return TRUE
+        else
+        {
+#ifdef SPR_PROFIL
+            profil_time[PROFIL_SET_VRAM_OR_SPRIND] += getSubTick() - prof;
+#endif // SPR_PROFIL
+
+            return TRUE;
+        }
+    }
+    else if (status & SPR_FLAG_AUTO_VRAM_ALLOC)
     {
         // pass to manual allocation
         if (value != -1)
@@ -1240,6 +1913,7 @@ bool SPR_setVRAMTileIndex(Sprite* sprite, s16 value)
 
     // save status
     sprite->status = status;
+    SET_HOT(sprite);
 
 #ifdef SPR_PROFIL
     profil_time[PROFIL_SET_VRAM_OR_SPRIND] += getSubTick() - prof;
@@ -1258,6 +1932,16 @@ bool SPR_setSpriteTableIndex(Sprite* sprite, s16 value)
     u16 status = sprite->status;
     u16 num = sprite->definition->maxNumSprite;
 
+    // VDP sprites are assigned on each update when multiplexing --> nothing to do
+    if (initFlag & SPR_INIT_FLAG_MULTIPLEX)
+    {
+#ifdef SPR_PROFIL
+        profil_time[PROFIL_SET_VRAM_OR_SPRIND] += getSubTick() - prof;
+#endif // SPR_PROFIL
+
+        return TRUE;
+    }
+
     if (status & SPR_FLAG_AUTO_SPRITE_ALLOC)
     {
         // pass to manual allocation
@@ -1328,6 +2012,7 @@ bool SPR_setSpriteTableIndex(Sprite* sprite, s16 value)
 
     // save status
     sprite->status = status;
+    SET_HOT(sprite);
 
 #ifdef SPR_PROFIL
     profil_time[PROFIL_SET_VRAM_OR_SPRIND] += getSubTick() - prof;
@@ -1348,6 +2033,62 @@ void SPR_setDelayedFrameUpdate(Sprite* sprite, bool value)
     else sprite->status |= SPR_FLAG_DISABLE_DELAYED_FRAME_UPDATE;
 }
 
+void SPR_setTileUploadBudget(u16 value)
+{
+    tileUploadBudget = value;
+}
+
+u16 SPR_getTileUploadBudget()
+{
+    return tileUploadBudget;
+}
+
+void SPR_setCullingMargin(u16 value)
+{
+    Sprite* sprite;
+
+    cullMargin = value;
+
+    // classify sprites again for the new margin (all far sprites are restored if far culling is disabled)
+    sprite = firstSprite;
+    while(sprite)
+    {
+        const u16 status = sprite->status;
+
+        if (status & SPR_FLAG_AUTO_VISIBILITY)
+        {
+            const bool far = value && isFar(sprite);
+
+            // not far anymore --> back to normal visibility handling
+            if ((status & FAR_CULLED) && !far)
+            {
+                sprite->status = (status & ~FAR_CULLED) | NEED_VISIBILITY_UPDATE | NEED_ST_POS_UPDATE;
+                SET_HOT(sprite);
+            }
+            // now far --> hide it
+            else if (!(status & FAR_CULLED) && far)
+                setFar(sprite);
+        }
+
+        sprite = sprite->next;
+    }
+}
+
+u16 SPR_getCullingMargin()
+{
+    return cullMargin;
+}
+
+u16 SPR_getNumDeferredFrameUpdate()
+{
+    return deferredLast;
+}
+
+u32 SPR_getTotalDeferredFrameUpdate()
+{
+    return deferredTotal;
+}
+
 void SPR_setFrameChangeCallback(Sprite* sprite, FrameChangeCallback* callback)
 {
     sprite->onFrameChange = callback;
@@ -1361,6 +2102,13 @@ void SPR_setVisibility(Sprite* sprite, SpriteVisibility value)
 
     u16 status = sprite->status;
 
+    // far culled ? --> back to normal visibility handling
+    if (status & FAR_CULLED)
+    {
+        status &= ~FAR_CULLED;
+        status |= NEED_VISIBILITY_UPDATE;
+    }
+
     if (status & SPR_FLAG_AUTO_VISIBILITY)
     {
         switch(value)
@@ -1415,6 +2163,7 @@ void SPR_setVisibility(Sprite* sprite, SpriteVisibility value)
 
     // update status
     sprite->status = status;
+    SET_HOT(sprite);
 
 #ifdef SPR_PROFIL
     profil_time[PROFIL_SET_VISIBILITY] += getSubTick() - prof;
@@ -1463,12 +2212,28 @@ void SPR_clear()
 
     // restore starter link
     starter->link = linkSave;
+    // starter has been sent with a null link, need to send it again on next update
+    SET_SAT_DIRTY(starter);
 
 #ifdef SPR_PROFIL
     profil_time[PROFIL_CLEAR] += getSubTick() - prof;
 #endif // SPR_PROFIL
 }
 
+void SPR_setVDPSpritesDirty(u16 index, u16 num)
+{
+    // whole sprite table
+    if (num == 0) setAllSATDirty();
+    else if (index < MAX_VDP_SPRITE)
+    {
+        VDPSprite* first = &vdpSpriteCache[index];
+        VDPSprite* last = &vdpSpriteCache[((index + num) > MAX_VDP_SPRITE)?(MAX_VDP_SPRITE - 1):(index + num - 1)];
+
+        SET_SAT_DIRTY(first);
+        SET_SAT_DIRTY(last);
+    }
+}
+
 void SPR_update()
 {
 #ifdef SPR_PROFIL
@@ -1476,34 +2241,78 @@ void SPR_update()
 #endif // SPR_PROFIL
 
     Sprite* sprite;
+    u16* hot;
+    u16 i;
+    // runtime statistics timing (only when enabled)
+    u16 t0 = 0;
+    u16 t1 = 0;
 
 #ifdef SPR_DEBUG
     KLog_U1("----------------- SPR_update:  sprite number = ", SPR_getNumActiveSprite());
 #endif // SPR_DEBUG
 
-#ifdef SPR_DEBUG
-    KLog_U1_("  Send sprites to DMA queue: ", highestVDPSpriteIndex + 1, " sprite(s) sent");
-#endif // SPR_DEBUG
+    if (statsEnabled) t0 = t1 = getSubTick();
 
-    const u16 sprNum = highestVDPSpriteIndex + 1;
-    // send sprites to VRAM using DMA queue (better to do it before sprite tiles upload to avoid being ignored by DMA queue)
-    void* vdpSpriteTableCopy = DMA_allocateAndQueueDma(DMA_VRAM, VDP_SPRITE_TABLE, (sizeof(VDPSprite) * sprNum) / 2, 2);
+    Sprite** tilesUpload = tilesUploadList;
+    // VDP sprite table is entirely rebuilt when multiplexing
+    const u16 multiplex = initFlag & SPR_INIT_FLAG_MULTIPLEX;
+    // animation frame is computed from global tick
+    const u16 globalTick = initFlag & SPR_INIT_FLAG_GLOBAL_ANIM_TICK;
 
-#if (LIB_LOG_LEVEL >= LOG_LEVEL_ERROR)
-    // DMA temporary buffer is full ? --> can't do sprite update
-    if (!vdpSpriteTableCopy)
+    // next animation tick
+    animTick++;
+
+    // sprite VRAM too fragmented ? --> do an incremental defragmentation step
+    if (defragThreshold && (VRAM_getLargestFreeBlock(&vram) < defragThreshold))
+        SPR_defragVRAMStep(defragMaxTile);
+
+    // deferred sort requested ? --> sort the whole list now
+    if (needSort) sortSprites();
+
+    if (statsEnabled)
     {
-        KLog("SPR_update(): failed... DMA data buffer is full.");
-        return;
+        const u16 t = getSubTick();
+        stats.sortTime = t - t1;
+        t1 = t;
     }
-#endif // LIB_DEBUG
 
-    // iterate over all sprites
-    sprite = firstSprite;
-    while(sprite)
+    // frame updates deferred by previous updates get the tiles upload budget first (oldest first)
+    if (deferredNum)
+    {
+        Sprite** src = deferredList;
+
+        i = deferredNum;
+        // list is rebuilt in place: updateFrame(..) appends the sprite again if still deferred (order is preserved)
+        deferredNum = 0;
+        while(i--)
+        {
+            sprite = *src++;
+            sprite->status &= ~DEFERRED_FRAME_UPDATE;
+            // frame may have been updated meanwhile by SPR_computeVisibility(..)
+            if (sprite->status & NEED_FRAME_UPDATE) sprite->status = updateFrame(sprite, sprite->status);
+        }
+    }
+
+    // iterate over the hot state array, only sprites requiring process are accessed
+    // (sprites are processed in bank order and not in depth order so frame update deferral, tiles upload order
+    // and frame change callbacks follow bank order, deferred frame updates have priority on next update)
+    hot = hotBank;
+    sprite = spritesBank;
+    i = bankEnd;
+    while(i--)
     {
+        // nothing to do for this sprite
+        if (!*hot)
+        {
+            hot++;
+            sprite++;
+            continue;
+        }
+
         u16 timer = sprite->timer;
 
+        stats.spriteProcessed++;
+
 #ifdef SPR_DEBUG
         char str1[32];
         char str2[8];
@@ -1515,8 +2324,16 @@ void SPR_update()
         KLog_U2_("  processing sprite pos #", getSpriteIndex(sprite), " - timer = ", timer, str1);
 #endif // SPR_DEBUG
 
+        // global tick mode --> compute animation frame only for visible sprite (or sprite which may become visible)
+        if (globalTick)
+        {
+            const Animation* anim = sprite->animation;
+
+            if (anim && anim->duration && (sprite->visibility || (sprite->status & NEED_VISIBILITY_UPDATE)))
+                updateTimeline(sprite);
+        }
         // handle frame animation
-        if (timer)
+        else if (timer)
         {
             // timer elapsed --> next frame
             if (--timer == 0) SPR_nextFrame(sprite);
@@ -1530,7 +2347,8 @@ void SPR_update()
         if (status & NEED_UPDATE)
         {
             // ! order is important !
-            if (status & NEED_FRAME_UPDATE)
+            // (frame update already deferred in this update ? --> keep it for next update)
+            if ((status & (NEED_FRAME_UPDATE | DEFERRED_FRAME_UPDATE)) == NEED_FRAME_UPDATE)
                 status = updateFrame(sprite, status);
             if (status & NEED_VISIBILITY_UPDATE)
                 status = updateVisibility(sprite, status);
@@ -1542,17 +2360,30 @@ void SPR_update()
                 if (status & NEED_ST_POS_UPDATE)
                 {
                     // update position (and so visibility)
-                    updateSpriteTablePos(sprite);
+                    if (!multiplex) updateSpriteTablePos(sprite);
                     status &= ~NEED_ST_POS_UPDATE;
                 }
             }
             // only if sprite is visible
             else
             {
+                // tiles upload is done after sprite table has been queued
                 if (status & NEED_TILES_UPLOAD)
-                    loadTiles(sprite);
+                {
+                    SharedTiles* shared = (status & SPR_FLAG_SHARED_TILES)?sharedBank[sprite->index]:NULL;
+
+                    // shared tiles are uploaded only once (by the first visible sprite using them)
+                    if (!shared || !shared->loaded)
+                    {
+                        if (shared) shared->loaded = TRUE;
+                        *tilesUpload++ = sprite;
+                        reservedTransferSize += sprite->frame->tileset->numTile * 32;
+                    }
+                }
 
-                if (status & NEED_ST_POS_UPDATE)
+                // VDP sprite table is rebuilt after when multiplexing
+                if (multiplex) {}
+                else if (status & NEED_ST_POS_UPDATE)
                 {
                     // not only position to update --> update whole table
                     if (status & NEED_ST_ATTR_UPDATE)
@@ -1571,12 +2402,101 @@ void SPR_update()
             sprite->status = status;
         }
 
+        // pending tiles upload / sprite table update of an hidden sprite wait for visibility change
+        if (!sprite->visibility) status &= NEED_VISIBILITY_UPDATE | NEED_FRAME_UPDATE | DEFERRED_FRAME_UPDATE | NEED_ST_POS_UPDATE;
+
+        // far sprite ? --> ignored until it comes back near screen (test sprite status as hidden sprite mask cleared it)
+        if (sprite->status & FAR_CULLED) *hot = FALSE;
+        // still something to process or animated frame ? --> keep it hot
+        else if (status & NEED_UPDATE) *hot = TRUE;
+        // global tick mode --> only visible animated sprite need to be processed
+        else if (globalTick) *hot = (sprite->visibility && sprite->animation && sprite->animation->duration)?TRUE:FALSE;
+        // animated frame ? --> keep it hot
+        else if (sprite->timer || (sprite->frame && sprite->frame->timer)) *hot = TRUE;
+        else *hot = FALSE;
+
         // next sprite
-        sprite = sprite->next;
+        hot++;
+        sprite++;
+    }
+
+    if (statsEnabled)
+    {
+        const u16 t = getSubTick();
+        stats.processTime = t - t1;
+        t1 = t;
+    }
+
+    // multiplexing ? --> rebuild the VDP sprite table
+    if (multiplex) multiplexSprites();
+
+    // sprite table modified ? --> send only the modified part to VRAM
+    if (satDirtyFirst <= satDirtyLast)
+    {
+        VDPSprite* last = &vdpSpriteCache[highestVDPSpriteIndex];
+
+        // ignore changes on VDP sprites above the highest allocated one
+        if (satDirtyLast < last) last = satDirtyLast;
+
+        if (satDirtyFirst <= last)
+        {
+            const u16 first = satDirtyFirst - vdpSpriteCache;
+            const u16 sprNum = (last - satDirtyFirst) + 1;
+
+#ifdef SPR_DEBUG
+            KLog_U2_("  Send sprites to DMA queue: ", sprNum, " sprite(s) sent from #", first, "");
+#endif // SPR_DEBUG
+
+            // send sprites to VRAM using DMA queue
+            void* vdpSpriteTableCopy = DMA_allocateAndQueueDmaEx(DMA_VRAM, VDP_SPRITE_TABLE + (first * sizeof(VDPSprite)), (sizeof(VDPSprite) * sprNum) / 2, 2, DMA_LANE_CRITICAL);
+
+            if (vdpSpriteTableCopy)
+            {
+                // copy the modified part of VDP sprite cache to the temporary buffer we got from DMA queue
+                memcpy(vdpSpriteTableCopy, satDirtyFirst, sizeof(VDPSprite) * sprNum);
+                // done
+                clearSATDirty();
+            }
+#if (LIB_LOG_LEVEL >= LOG_LEVEL_ERROR)
+            // can't queue sprite table --> keep it dirty so we retry on next update
+            else KLog("SPR_update(): sprite table upload failed... DMA queue or buffer is full.");
+#endif // LIB_DEBUG
+        }
+        // nothing to send
+        else clearSATDirty();
+    }
+
+    if (statsEnabled)
+    {
+        const u16 t = getSubTick();
+        stats.tableTime = t - t1;
+        t1 = t;
     }
 
-    // VDP sprite cache is now updated, copy it to the temporary cache copy we got from DMA queue buffer
-    memcpy(vdpSpriteTableCopy, vdpSpriteCache, sizeof(VDPSprite) * sprNum);
+    // then do pending tiles upload
+    Sprite** spr = tilesUploadList;
+    while(spr < tilesUpload) loadTiles(*spr++);
+
+    // everything is queued now
+    reservedTransferSize = 0;
+    // new tiles upload budget for next update
+    tileUploadSize = 0;
+    // store deferred frame update counter for this update
+    deferredLast = deferredCount;
+    deferredCount = 0;
+
+    // store runtime statistics for this update
+    if (statsEnabled)
+    {
+        const u16 t = getSubTick();
+        stats.tileTime = t - t1;
+        stats.totalTime = t - t0;
+
+        statsHistory[statsPos] = stats;
+        statsPos = (statsPos + 1) & (SPR_STATS_HISTORY - 1);
+        if (statsNum < SPR_STATS_HISTORY) statsNum++;
+    }
+    memset(&stats, 0, sizeof(stats));
 
 #ifdef SPR_PROFIL
     profil_time[PROFIL_UPDATE] += getSubTick() - prof;
@@ -1598,12 +2518,57 @@ void SPR_logProfil()
     KLog_U2x(4, "Update visibility=", profil_time[PROFIL_UPDATE_VISIBILITY], "  Update frame=", profil_time[PROFIL_UPDATE_FRAME]);
     KLog_U2x(4, "Update vdp_spr_ind=", profil_time[PROFIL_UPDATE_VDPSPRIND], "  Update vis spr table=", profil_time[PROFIL_UPDATE_VISTABLE]);
     KLog_U2x(4, "Update Sprite Table=", profil_time[PROFIL_UPDATE_SPRITE_TABLE], " Load Tiles=", profil_time[PROFIL_LOADTILES]);
+    if (initFlag & SPR_INIT_FLAG_MULTIPLEX)
+        KLog_U2x(4, "Multiplex=", profil_time[PROFIL_MULTIPLEX], " Dropped (last update)=", multiplexDropped);
+    KLog_U2("Deferred frame update (last update)=", deferredLast, " total=", deferredTotal);
 
     // reset profil counters
     memset(profil_time, 0, sizeof(profil_time));
 #endif // SPR_PROFIL
 }
 
+u16 SPR_getNumDroppedSprite()
+{
+    return multiplexDropped;
+}
+
+bool SPR_isAltCuttingActive()
+{
+    return altCutting;
+}
+
+void SPR_setStatsEnabled(bool value)
+{
+    statsEnabled = value;
+    // restart history
+    statsPos = 0;
+    statsNum = 0;
+}
+
+const SpriteFrameStats* SPR_getFrameStats(u16 age)
+{
+    if (age >= statsNum) return NULL;
+
+    return &statsHistory[(statsPos - (age + 1)) & (SPR_STATS_HISTORY - 1)];
+}
+
+void SPR_logFrameStats(u16 num)
+{
+    if (num > statsNum) num = statsNum;
+
+    KLog("SPR frame stats: processed frame vis sort tiles(bytes) deferred | sort process table tiles total (sub tick)");
+
+    while(num--)
+    {
+        const SpriteFrameStats* st = SPR_getFrameStats(num);
+
+        KLog_U4("proc=", st->spriteProcessed, " frame=", st->frameUpdate, " vis=", st->visibilityUpdate, " sort=", st->sort);
+        KLog_U2("  tiles=", st->tileUpload, " deferred=", st->frameDeferred);
+        KLog_U4("  t.sort=", st->sortTime, " t.proc=", st->processTime, " t.table=", st->tableTime, " t.tiles=", st->tileTime);
+        KLog_U1("  t.total=", st->totalTime);
+    }
+}
+
 void SPR_logSprites()
 {
     Sprite* sprite = firstSprite;
@@ -1631,6 +2596,19 @@ static void setVDPSpriteIndex(Sprite* sprite, u16 ind, u16 num)
     KLog_U2("setVDPSpriteIndex: sprite #", getSpriteIndex(sprite), "  new VDP Sprite index = ", ind);
 #endif // SPR_DEBUG
 
+    // multiplexing ? --> VDP sprites are assigned on each update
+    if (initFlag & SPR_INIT_FLAG_MULTIPLEX)
+    {
+        sprite->VDPSpriteIndex = 0;
+        sprite->lastVDPSprite = &dummyVDPSprite;
+
+#ifdef SPR_PROFIL
+        profil_time[PROFIL_UPDATE_VDPSPRIND] += getSubTick() - prof;
+#endif // SPR_PROFIL
+
+        return;
+    }
+
     sprite->VDPSpriteIndex = ind;
 
     // we don't need to hide sprite by default anymore as we take of it with 'lastNumSprite' field
@@ -1645,17 +2623,30 @@ static void setVDPSpriteIndex(Sprite* sprite, u16 ind, u16 num)
 //        vdpSprite->y = 0;
 //    }
 
-    // get the last vdpSprite
+    // get the last vdpSprite (VDP sprites links may have been modified by allocation)
     vdpSprite = &vdpSpriteCache[ind];
+    SET_SAT_DIRTY(vdpSprite);
     i = num - 1;
-    while(i--) vdpSprite = &vdpSpriteCache[vdpSprite->link];
+    while(i--)
+    {
+        vdpSprite = &vdpSpriteCache[vdpSprite->link];
+        SET_SAT_DIRTY(vdpSprite);
+    }
 
     // adjust VDP sprites links
     spr = sprite->prev;
     // do we have a previous sprite ? --> set its next link to current sprite index
-    if (spr) spr->lastVDPSprite->link = ind;
+    if (spr)
+    {
+        spr->lastVDPSprite->link = ind;
+        SET_SAT_DIRTY(spr->lastVDPSprite);
+    }
     // othrwise we set started link
-    else starter->link = ind;
+    else
+    {
+        starter->link = ind;
+        SET_SAT_DIRTY(starter);
+    }
 
     spr = sprite->next;
     // do we have a next sprite ? --> set link on next sprite
@@ -1681,6 +2672,8 @@ static u16 updateVisibility(Sprite* sprite, u16 status)
     s32 prof = getSubTick();
 #endif // SPR_PROFIL
 
+    stats.visibilityUpdate++;
+
     u16 visibility;
     AnimationFrame* frame = sprite->frame;
 
@@ -1816,34 +2809,101 @@ static u16 updateFrame(Sprite* sprite, u16 status)
     KLog_U1("  updateFrame: sprite #", getSpriteIndex(sprite));
 #endif // SPR_DEBUG
 
-    AnimationFrame* frame = sprite->animation->frames[sprite->frameInd];
+    AnimationFrame* const base = sprite->animation->frames[sprite->frameInd];
+    AnimationFrame* frame = base;
+
+    // short of hardware sprites ? --> use alternative cutting if any (need auto tiles upload as tiles differ)
+    if (altCutting && base->alt && (status & SPR_FLAG_AUTO_TILE_UPLOAD)) frame = base->alt;
+
+    // only the cutting changes ? (same animation frame)
+    const AnimationFrame* previous = sprite->frame;
+    const bool cuttingOnly = previous && (previous != frame) && ((previous == base) || (previous == base->alt));
+
+    // tiles data (in bytes) to upload for the new frame
+    u16 size = 0;
 
     // we need to transfert tiles data for this sprite and frame delay is not disabled ?
     if ((status & (SPR_FLAG_AUTO_TILE_UPLOAD | SPR_FLAG_DISABLE_DELAYED_FRAME_UPDATE)) == SPR_FLAG_AUTO_TILE_UPLOAD)
+    {
+        const SharedTiles* shared = NULL;
+
+        // shared tiles ? --> get the entry the new frame will use (if already in cache)
+        if (status & SPR_FLAG_SHARED_TILES)
+        {
+            shared = sharedBank[sprite->index];
+            if (!shared || (shared->tileset != frame->tileset)) shared = findSharedTiles(frame->tileset);
+        }
+
+        // shared tiles already loaded don't need any transfer
+        if (!shared || !shared->loaded) size = frame->tileset->numTile * 32;
+    }
+
+    // tiles data transfer required ?
+    if (size)
     {
         // not enough DMA capacity to transfer sprite tile data ?
         const u16 dmaCapacity = DMA_getMaxTransferSize();
 
-        if (dmaCapacity && (DMA_getQueueTransferSize() + (frame->tileset->numTile * 32)) > dmaCapacity)
+        // (background transfers only use remaining capacity so they don't count here)
+        const u16 queued = DMA_getQueueTransferSize() - DMA_getLaneTransferSize(DMA_LANE_BACKGROUND);
+        // sprite table is sent before sprite tiles (to avoid being ignored by DMA queue) so its modified part is reserved too
+        const u16 reserved = reservedTransferSize + getSATTransferSize();
+
+        if (dmaCapacity && (queued + reserved + size) > dmaCapacity)
         {
 #if (LIB_LOG_LEVEL >= LOG_LEVEL_WARNING)
-            KLog_U3_("Warning: sprite #", getSpriteIndex(sprite), " update delayed (exceeding DMA capacity: ", DMA_getQueueTransferSize(), " bytes already queued and require ", frame->tileset->numTile * 32, " more bytes)");
+            KLog_U3_("Warning: sprite #", getSpriteIndex(sprite), " update delayed (exceeding DMA capacity: ", queued + reserved, " bytes already queued and require ", size, " more bytes)");
+#endif // LIB_DEBUG
+
+            // delay frame update (when we will have enough DMA capacity to do it)
+            return deferFrameUpdate(sprite, status);
+        }
+        // exceeding tiles upload budget ? (we always accept the first frame update)
+        if (tileUploadBudget && tileUploadSize && ((tileUploadSize + size) > tileUploadBudget))
+        {
+#if (LIB_LOG_LEVEL >= LOG_LEVEL_INFO)
+            KLog_U3("Sprite #", getSpriteIndex(sprite), " update delayed (exceeding tiles upload budget: ", tileUploadSize, " bytes already used and require ", size, " more bytes)");
 #endif // LIB_DEBUG
 
-            // initial frame update ? --> better to set frame and frameInfo pointer at least
-            if (sprite->frame == NULL)
+            // delay frame update (on next update, before others sprites)
+            return deferFrameUpdate(sprite, status);
+        }
+    }
+
+    // shared tiles ? --> get VRAM tiles for new frame (allocated if no other sprite uses them)
+    if (status & SPR_FLAG_SHARED_TILES)
+    {
+        SharedTiles** ref = &sharedBank[sprite->index];
+        SharedTiles* entry = *ref;
+
+        // tiles changed ?
+        if (!entry || (entry->tileset != frame->tileset))
+        {
+            SharedTiles* newEntry = acquireSharedTiles(frame->tileset);
+
+            // not enough VRAM ?
+            if (!newEntry)
             {
-                // set frame
-                sprite->frame = frame;
-                // get frame info depending HV flip state
-                sprite->frameInfo = &(frame->frameInfos[(sprite->attribut & (TILE_ATTR_HFLIP_MASK | TILE_ATTR_VFLIP_MASK)) >> TILE_ATTR_HFLIP_SFT]);
+#if (LIB_LOG_LEVEL >= LOG_LEVEL_WARNING)
+                KLog_U2("Warning: sprite #", getSpriteIndex(sprite), " update delayed (not enough VRAM for shared tiles, require ", frame->tileset->numTile, " tiles)");
+#endif // LIB_DEBUG
+
+                // delay frame update (when we will have enough VRAM to do it)
+                return status;
             }
 
-            // delay frame update (when we will have enough DMA capacity to do it)
-            return status;
+            // release previous frame tiles (after acquire so we don't free / re-alloc the same tiles)
+            if (entry) releaseSharedTiles(entry);
+            *ref = newEntry;
+
+            // set VRAM index and preserve previous attributs
+            sprite->attribut = (sprite->attribut & TILE_ATTR_MASK) | newEntry->vramIndex;
         }
     }
 
+    // consume budget (frame update can't be delayed anymore)
+    tileUploadSize += size;
+
     // detect if we need to hide some VDP sprite
     s16 currentNumSprite = frame->numSprite;
     s16 spriteToHide = sprite->lastNumSprite - currentNumSprite;
@@ -1859,8 +2919,9 @@ static u16 updateFrame(Sprite* sprite, u16 status)
     // get frame info depending HV flip state
     sprite->frameInfo = &(frame->frameInfos[(sprite->attribut & (TILE_ATTR_HFLIP_MASK | TILE_ATTR_VFLIP_MASK)) >> TILE_ATTR_HFLIP_SFT]);
 
-    // init timer for this frame
-    sprite->timer = frame->timer;
+    // init timer for this frame (not used in global tick mode, preserved on cutting change)
+    if (!(initFlag & SPR_INIT_FLAG_GLOBAL_ANIM_TICK) && (!cuttingOnly || !sprite->timer))
+        sprite->timer = frame->timer;
 
     // frame change event handler defined ? --> call it
     if (sprite->onFrameChange)
@@ -1880,6 +2941,7 @@ static u16 updateFrame(Sprite* sprite, u16 status)
 
     // frame update done
     status &= ~NEED_FRAME_UPDATE;
+    stats.frameUpdate++;
 
 #ifdef SPR_PROFIL
     profil_time[PROFIL_UPDATE_FRAME] += getSubTick() - prof;
@@ -1889,34 +2951,266 @@ static u16 updateFrame(Sprite* sprite, u16 status)
     return status | NEED_ST_ALL_UPDATE;
 }
 
-static void updateSpriteTableAll(Sprite* sprite)
+static bool isFar(Sprite* sprite)
 {
-#ifdef SPR_PROFIL
-    s32 prof = getSubTick();
-#endif // SPR_PROFIL
+    const AnimationFrame* frame = sprite->frame;
 
-    FrameVDPSprite** frameSprites;
-    VDPSprite* vdpSprite;
-    u16 attr;
-    u16 num;
-    u16 visibility;
+    // no frame yet (first frame update still pending) --> use size of the pending frame
+    if (!frame) frame = sprite->animation->frames[sprite->frameInd];
 
-    visibility = sprite->visibility;
-    attr = sprite->attribut;
-    num = sprite->frame->numSprite;
-    frameSprites = sprite->frameInfo->frameVDPSprites;
-    vdpSprite = &vdpSpriteCache[sprite->VDPSpriteIndex];
+    const s16 m = cullMargin;
+    const s16 x = sprite->x;
+    const s16 y = sprite->y;
 
-    while(num--)
-    {
-        FrameVDPSprite* frameSprite = *frameSprites++;
+    // bounding box farther than margin from screen (sprite position is offseted by 0x80)
+    if ((x + frame->w + m) <= 0x80) return TRUE;
+    if (x >= (screenWidth + 0x80 + m)) return TRUE;
+    if ((y + frame->h + m) <= 0x80) return TRUE;
+    if (y >= (screenHeight + 0x80 + m)) return TRUE;
 
-        // Y first to respect VDP field order
-        if (visibility & 1) vdpSprite->y = sprite->y + frameSprite->offsetY;
-        else vdpSprite->y = 0;
+    return FALSE;
+}
+
+static void setFar(Sprite* sprite)
+{
+    // hide it (done via pos Y) without computing visibility
+    sprite->status = (sprite->status & ~NEED_VISIBILITY_UPDATE) | FAR_CULLED | setVisibility(sprite, VISIBILITY_OFF);
+    // still need to be processed once to hide it
+    SET_HOT(sprite);
+}
+
+static void setPosition(Sprite* sprite, s16 x, s16 y)
+{
+    const s16 newx = x + 0x80;
+    const s16 newy = y + 0x80;
+
+#ifdef SPR_DEBUG
+    KLog_U3("setPosition: #", getSpriteIndex(sprite), "  X=", newx, " Y=", newy);
+#endif // SPR_DEBUG
+
+    if ((sprite->x != newx) || (sprite->y != newy))
+    {
+        u16 status = sprite->status;
+
+        sprite->x = newx;
+        sprite->y = newy;
+
+        // far culling enabled for this sprite ?
+        if (cullMargin && (status & SPR_FLAG_AUTO_VISIBILITY))
+        {
+            if (isFar(sprite))
+            {
+                // not yet far culled --> hide it
+                if (!(status & FAR_CULLED)) setFar(sprite);
+
+                return;
+            }
+
+            // back near screen
+            status &= ~FAR_CULLED;
+        }
+
+        // need to recompute visibility if auto visibility is enabled
+        if (status & SPR_FLAG_AUTO_VISIBILITY)
+            status |= NEED_VISIBILITY_UPDATE;
+
+        sprite->status = status | NEED_ST_POS_UPDATE;
+        SET_HOT(sprite);
+    }
+}
+
+static void relocateTiles(u16 from, u16 to, u16 size)
+{
+    SharedTiles* shared = NULL;
+    SharedTiles* entry;
+    Sprite* owner = NULL;
+    Sprite* sprite;
+    u16 i;
+
+    // is it a shared tiles block ?
+    entry = sharedTiles;
+    i = sharedEnd;
+    while(i--)
+    {
+        if (entry->refCount && (entry->vramIndex == from))
+        {
+            shared = entry;
+            break;
+        }
+
+        entry++;
+    }
+
+    // otherwise find the sprite owning it
+    if (!shared)
+    {
+        sprite = firstSprite;
+        while(sprite)
+        {
+            if ((sprite->status & SPR_FLAG_AUTO_VRAM_ALLOC) && ((sprite->attribut & TILE_INDEX_MASK) == from))
+            {
+                owner = sprite;
+                break;
+            }
+
+            sprite = sprite->next;
+        }
+    }
+
+    // queue tile data copy in critical lane: done on VBlank with (and before) the sprite table update so there is no glitch
+    // even if source and destination overlap, and before any tiles upload reusing the source area
+    bool upload = !DMA_queueVRamCopyEx(from * 32, to * 32, size * 32, 1, DMA_LANE_CRITICAL);
+
+    // can't queue copy ? --> upload tiles again if possible, otherwise copy immediately
+    if (upload && !shared && !(owner && (owner->status & SPR_FLAG_AUTO_TILE_UPLOAD)))
+    {
+        DMA_doVRamCopy(from * 32, to * 32, size * 32, 1);
+        DMA_waitCompletion();
+        upload = FALSE;
+    }
+
+    if (shared)
+    {
+        shared->vramIndex = to;
+        if (upload) shared->loaded = FALSE;
+
+        // update all sprites using these tiles
+        sprite = firstSprite;
+        while(sprite)
+        {
+            if ((sprite->status & SPR_FLAG_SHARED_TILES) && (sharedBank[sprite->index] == shared))
+            {
+                // set VRAM index and preserve previous attributs
+                sprite->attribut = (sprite->attribut & TILE_ATTR_MASK) | to;
+                // need to update attribute VDP sprite table (and tiles if not copied)
+                sprite->status |= upload?(NEED_ST_ATTR_UPDATE | NEED_TILES_UPLOAD):NEED_ST_ATTR_UPDATE;
+                SET_HOT(sprite);
+            }
+
+            sprite = sprite->next;
+        }
+    }
+    else if (owner)
+    {
+        // set VRAM index and preserve previous attributs
+        owner->attribut = (owner->attribut & TILE_ATTR_MASK) | to;
+        // need to update attribute VDP sprite table (and tiles if not copied)
+        owner->status |= upload?(NEED_ST_ATTR_UPDATE | NEED_TILES_UPLOAD):NEED_ST_ATTR_UPDATE;
+        SET_HOT(owner);
+    }
+}
+
+static void updateTimeline(Sprite* sprite)
+{
+    const Animation* anim = sprite->animation;
+    const u16* timeline = anim->timeline;
+    const u16 duration = anim->duration;
+    const u16 last = anim->length - 1;
+    u16 t = animTick - sprite->timer;
+
+    // past the end of the sequence ? --> wrap in loop part
+    if (t >= duration)
+    {
+        const u16 loopStart = timeline[anim->loop];
+        t = loopStart + ((t - loopStart) % (duration - loopStart));
+        // rebase animation start on current loop so elapsed ticks stay small (tick counter can safely wrap)
+        sprite->timer = animTick - t;
+    }
+
+    u16 seq = sprite->seqInd;
+
+    // timeline is ordered so search forward from current step if possible
+    if ((seq > last) || (timeline[seq] > t)) seq = 0;
+    while((seq < last) && (timeline[seq + 1] <= t)) seq++;
+
+    // sequence step changed ?
+    if (seq != (u16) sprite->seqInd)
+    {
+        const s16 frameInd = anim->sequence[seq];
+
+        sprite->seqInd = seq;
+
+        if (sprite->frameInd != frameInd)
+        {
+            sprite->frameInd = frameInd;
+            sprite->status |= NEED_FRAME_UPDATE;
+        }
+    }
+}
+
+static u16 deferFrameUpdate(Sprite* sprite, u16 status)
+{
+    // initial frame update ? --> better to set frame and frameInfo pointer at least
+    if (sprite->frame == NULL)
+    {
+        AnimationFrame* frame = sprite->animation->frames[sprite->frameInd];
+
+        // set frame
+        sprite->frame = frame;
+        // get frame info depending HV flip state
+        sprite->frameInfo = &(frame->frameInfos[(sprite->attribut & (TILE_ATTR_HFLIP_MASK | TILE_ATTR_VFLIP_MASK)) >> TILE_ATTR_HFLIP_SFT]);
+    }
+
+    // not yet in deferred list ? --> add it (at end so oldest are processed first)
+    if (!(status & DEFERRED_FRAME_UPDATE))
+    {
+        deferredList[deferredNum++] = sprite;
+        status |= DEFERRED_FRAME_UPDATE;
+    }
+
+    deferredCount++;
+    deferredTotal++;
+    stats.frameDeferred++;
+
+    return status;
+}
+
+static void removeDeferredFrameUpdate(Sprite* sprite)
+{
+    Sprite** src = deferredList;
+    Sprite** dst = deferredList;
+    u16 i = deferredNum;
+
+    // remove sprite while preserving order
+    while(i--)
+    {
+        Sprite* spr = *src++;
+        if (spr != sprite) *dst++ = spr;
+    }
+
+    deferredNum = dst - deferredList;
+    sprite->status &= ~DEFERRED_FRAME_UPDATE;
+}
+
+static void updateSpriteTableAll(Sprite* sprite)
+{
+#ifdef SPR_PROFIL
+    s32 prof = getSubTick();
+#endif // SPR_PROFIL
+
+    FrameVDPSprite** frameSprites;
+    VDPSprite* vdpSprite;
+    u16 attr;
+    u16 num;
+    u16 visibility;
+
+    visibility = sprite->visibility;
+    attr = sprite->attribut;
+    num = sprite->frame->numSprite;
+    frameSprites = sprite->frameInfo->frameVDPSprites;
+    vdpSprite = &vdpSpriteCache[sprite->VDPSpriteIndex];
+
+    while(num--)
+    {
+        FrameVDPSprite* frameSprite = *frameSprites++;
+
+        // Y first to respect VDP field order
+        if (visibility & 1) vdpSprite->y = sprite->y + frameSprite->offsetY;
+        else vdpSprite->y = 0;
         vdpSprite->size = frameSprite->size;
         vdpSprite->attribut = attr;
         vdpSprite->x = sprite->x + frameSprite->offsetX;
+        SET_SAT_DIRTY(vdpSprite);
 
         // increment tile index in attribut field
         attr += frameSprite->numTile;
@@ -1931,6 +3225,7 @@ static void updateSpriteTableAll(Sprite* sprite)
         while(num--)
         {
             vdpSprite->y = 0;
+            SET_SAT_DIRTY(vdpSprite);
             vdpSprite = &vdpSpriteCache[vdpSprite->link];
         }
 
@@ -1980,6 +3275,7 @@ static void updateSpriteTablePos(Sprite* sprite)
         if (visibility & 1) vdpSprite->y = sprite->y + frameSprite->offsetY;
         else vdpSprite->y = 0;
         vdpSprite->x = sprite->x + frameSprite->offsetX;
+        SET_SAT_DIRTY(vdpSprite);
 
         // pass to next VDP sprite
         visibility >>= 1;
@@ -1992,6 +3288,7 @@ static void updateSpriteTablePos(Sprite* sprite)
         while(num--)
         {
             vdpSprite->y = 0;
+            SET_SAT_DIRTY(vdpSprite);
             vdpSprite = &vdpSpriteCache[vdpSprite->link];
         }
 
@@ -2041,6 +3338,7 @@ static void updateSpriteTableAttr(Sprite* sprite)
         FrameVDPSprite* frameSprite = *frameSprites++;
 
         vdpSprite->attribut = attr;
+        SET_SAT_DIRTY(vdpSprite);
 
         // increment tile index in attribut field
         attr += frameSprite->numTile;
@@ -2076,6 +3374,8 @@ static void loadTiles(Sprite* sprite)
     u16 compression = tileset->compression;
     u16 lenInWord = (tileset->numTile * 32) / 2;
 
+    stats.tileUpload += lenInWord * 2;
+
     // TODO: separate tileset per VDP sprite and only unpack/upload visible VDP sprite (using visibility) to VRAM
 
     // need unpacking ?
@@ -2124,6 +3424,8 @@ static Sprite* sortSprite(Sprite* sprite)
     s32 prof = getSubTick();
 #endif // SPR_PROFIL
 
+    stats.sort++;
+
     Sprite* const prev = sprite->prev;
     Sprite* const next = sprite->next;
     Sprite* s;
@@ -2237,6 +3539,517 @@ static void moveAfter(Sprite* pos, Sprite* sprite)
         sprite->lastVDPSprite->link = starter->link;
         starter->link = sprite->VDPSpriteIndex;
     }
+
+    // links modified (multiplexing rebuilds the sprite table on each update)
+    if (!(initFlag & SPR_INIT_FLAG_MULTIPLEX))
+    {
+        SET_SAT_DIRTY(prev?prev->lastVDPSprite:starter);
+        SET_SAT_DIRTY(pos?pos->lastVDPSprite:starter);
+        SET_SAT_DIRTY(sprite->lastVDPSprite);
+    }
+}
+
+static void sortSprites()
+{
+#ifdef SPR_PROFIL
+    s32 prof = getSubTick();
+#endif // SPR_PROFIL
+
+    u16 counts[256];
+    Sprite** src;
+    Sprite** dst;
+    Sprite** tmp;
+    Sprite* sprite;
+    u16 keyOr, keyAnd;
+    u16 last;
+    u16 num;
+    bool sorted;
+    u16 i;
+
+    stats.sort++;
+
+    src = sortBuffer;
+    dst = sortBuffer + bankSize;
+
+    keyOr = 0;
+    keyAnd = 0xFFFF;
+    last = 0;
+    sorted = TRUE;
+    num = 0;
+
+    // gather sprites, depth is converted to unsigned key (SPR_MIN_DEPTH --> 0)
+    sprite = firstSprite;
+    while(sprite)
+    {
+        const u16 key = sprite->depth ^ 0x8000;
+
+        if (key < last) sorted = FALSE;
+        last = key;
+        keyOr |= key;
+        keyAnd &= key;
+
+        src[num++] = sprite;
+        sprite = sprite->next;
+    }
+
+    needSort = FALSE;
+
+    // already sorted --> nothing to do
+    if (sorted)
+    {
+#ifdef SPR_PROFIL
+        profil_time[PROFIL_SORT] += getSubTick() - prof;
+#endif // SPR_PROFIL
+
+        return;
+    }
+
+    // stable LSD radix sort (8 bits per pass), pass is skipped when all keys share the same byte
+    for(u16 shift = 0; shift < 16; shift += 8)
+    {
+        if (!(((keyOr ^ keyAnd) >> shift) & 0xFF)) continue;
+
+        memset(counts, 0, sizeof(counts));
+        for(i = 0; i < num; i++)
+            counts[((src[i]->depth ^ 0x8000) >> shift) & 0xFF]++;
+
+        // convert counts to start offsets
+        u16 offset = 0;
+        for(i = 0; i < 256; i++)
+        {
+            const u16 c = counts[i];
+            counts[i] = offset;
+            offset += c;
+        }
+
+        for(i = 0; i < num; i++)
+        {
+            sprite = src[i];
+            dst[counts[((sprite->depth ^ 0x8000) >> shift) & 0xFF]++] = sprite;
+        }
+
+        // swap buffers
+        tmp = src;
+        src = dst;
+        dst = tmp;
+    }
+
+    // rebuild sprite list and VDP sprite links in a single pass
+    VDPSprite* lastVDPSprite = starter;
+    Sprite* prev = NULL;
+    // multiplexing rebuilds the sprite table on each update
+    const u16 multiplex = initFlag & SPR_INIT_FLAG_MULTIPLEX;
+
+    for(i = 0; i < num; i++)
+    {
+        sprite = src[i];
+
+        sprite->prev = prev;
+        if (prev) prev->next = sprite;
+        else firstSprite = sprite;
+
+        // only relinked VDP sprites need to be uploaded
+        const u16 link = sprite->VDPSpriteIndex;
+        if (lastVDPSprite->link != link)
+        {
+            lastVDPSprite->link = link;
+            if (!multiplex) SET_SAT_DIRTY(lastVDPSprite);
+        }
+
+        lastVDPSprite = sprite->lastVDPSprite;
+        prev = sprite;
+    }
+
+    // 'num' can't be 0 here (list wasn't sorted)
+    prev->next = NULL;
+    lastSprite = prev;
+    if (lastVDPSprite->link)
+    {
+        lastVDPSprite->link = 0;
+        if (!multiplex) SET_SAT_DIRTY(lastVDPSprite);
+    }
+
+#ifdef SPR_PROFIL
+    profil_time[PROFIL_SORT] += getSubTick() - prof;
+#endif // SPR_PROFIL
+}
+
+static bool allocateSharedTiles()
+{
+    const u16 prevTag = MEM_setTag(MEM_TAG_SPRITE);
+
+    sharedTiles = MEM_alloc(bankSize * sizeof(SharedTiles));
+    sharedBank = MEM_alloc(bankSize * sizeof(SharedTiles*));
+
+    MEM_setTag(prevTag);
+
+    if (!sharedTiles || !sharedBank)
+    {
+#if (LIB_LOG_LEVEL >= LOG_LEVEL_ERROR)
+        KLog("SPR_addSprite: can't allocate shared tiles cache, tiles won't be shared !");
+#endif
+
+        MEM_free(sharedTiles);
+        sharedTiles = NULL;
+        MEM_free(sharedBank);
+        sharedBank = NULL;
+
+        return FALSE;
+    }
+
+    memset(sharedTiles, 0, sizeof(SharedTiles) * bankSize);
+    memset(sharedBank, 0, sizeof(SharedTiles*) * bankSize);
+    sharedEnd = 0;
+
+    return TRUE;
+}
+
+static SharedTiles* findSharedTiles(const TileSet* tileset)
+{
+    SharedTiles* entry = sharedTiles;
+    u16 i = sharedEnd;
+
+    while(i--)
+    {
+        if (entry->refCount && (entry->tileset == tileset)) return entry;
+        entry++;
+    }
+
+    return NULL;
+}
+
+static SharedTiles* acquireSharedTiles(const TileSet* tileset)
+{
+    SharedTiles* entry = sharedTiles;
+    SharedTiles* freeEntry = NULL;
+    u16 i = sharedEnd;
+
+    // already in cache ? --> just add a reference
+    while(i--)
+    {
+        if (entry->refCount)
+        {
+            if (entry->tileset == tileset)
+            {
+                entry->refCount++;
+                return entry;
+            }
+        }
+        else if (!freeEntry) freeEntry = entry;
+
+        entry++;
+    }
+
+    // allocate VRAM
+    const s16 ind = VRAM_alloc(&vram, tileset->numTile);
+    // not enough --> return NULL
+    if (ind < 0) return NULL;
+
+    // no free entry --> use a new one
+    if (!freeEntry) freeEntry = &sharedTiles[sharedEnd++];
+
+    freeEntry->tileset = tileset;
+    freeEntry->vramIndex = ind;
+    freeEntry->refCount = 1;
+    freeEntry->loaded = FALSE;
+
+#ifdef SPR_DEBUG
+    KLog_U3("  allocated ", tileset->numTile, " shared tiles in VRAM at ", ind, ", remaining VRAM: ", VRAM_getFree(&vram));
+#endif // SPR_DEBUG
+
+    return freeEntry;
+}
+
+static void releaseSharedTiles(SharedTiles* entry)
+{
+    // still used ? --> nothing more to do
+    if (--entry->refCount) return;
+
+    VRAM_free(&vram, entry->vramIndex);
+    entry->tileset = NULL;
+
+#ifdef SPR_DEBUG
+    KLog_U2("  released shared tiles in VRAM at ", entry->vramIndex, ", remaining VRAM: ", VRAM_getFree(&vram));
+#endif // SPR_DEBUG
+
+    // trim unused entries at end of cache
+    while(sharedEnd && !sharedTiles[sharedEnd - 1].refCount) sharedEnd--;
+}
+
+static void multiplexSprites()
+{
+#ifdef SPR_PROFIL
+    s32 prof = getSubTick();
+#endif // SPR_PROFIL
+
+    Sprite** list = multiplexList;
+    Sprite* sprite;
+    u16 num, remaining;
+    u16 dropped, firstDropped;
+    u16 start;
+    u16 i;
+
+    // hardware limits depending screen width
+    const u16 h40 = (screenWidth > 256);
+    u16 slots = h40?(80 - 1):(64 - 1);
+    const u16 lineMax = h40?20:16;
+    const u16 dotMax = screenWidth;
+
+    // get visible sprites (in depth order) and locate the start sprite (use its last position if it's gone)
+    num = 0;
+    start = multiplexStartPos;
+    sprite = firstSprite;
+    while(sprite)
+    {
+        if (sprite->visibility && sprite->frame)
+        {
+            if (sprite->index == multiplexStart) start = num;
+            list[num++] = sprite;
+        }
+        sprite = sprite->next;
+    }
+
+    memset(bandCount, 0, sizeof(bandCount));
+    memset(bandDots, 0, sizeof(bandDots));
+
+    // select sprites starting from the first sprite we dropped on last update
+    i = start;
+    if (i >= num) i = 0;
+    dropped = 0;
+    firstDropped = 0;
+    remaining = num;
+    while(remaining--)
+    {
+        sprite = list[i];
+
+        // count VDP sprites really used
+        u16 visibility = sprite->visibility;
+        u16 n = sprite->frame->numSprite;
+        u16 used = 0;
+        while(n--)
+        {
+            used += visibility & 1;
+            visibility >>= 1;
+        }
+
+        // enough hardware sprites and scanline budget ? --> consume them
+        if ((used <= slots) && multiplexFit(sprite, lineMax, dotMax)) slots -= used;
+        else
+        {
+            // keep trace of the first dropped sprite (will have priority on next update)
+            if (!dropped)
+            {
+                firstDropped = i;
+                multiplexStart = sprite->index;
+            }
+            dropped++;
+            // remove from display list
+            list[i] = NULL;
+        }
+
+        if (++i >= num) i = 0;
+    }
+
+    // nothing dropped --> no start sprite
+    if (!dropped) multiplexStart = 0xFFFF;
+    multiplexStartPos = firstDropped;
+    multiplexDropped = dropped;
+
+    // alternative cutting enabled ? --> check for hardware sprite pressure
+    if (initFlag & SPR_INIT_FLAG_ALT_CUTTING)
+    {
+        bool pressure = dropped || (slots < ALT_CUTTING_SLOT_MARGIN);
+
+        // saturated scanline band ?
+        for(i = 0; !pressure && (i < MULTIPLEX_NUM_BAND); i++)
+            if ((bandCount[i] >= lineMax) || (bandDots[i] >= dotMax)) pressure = TRUE;
+
+        if (pressure)
+        {
+            altCalm = 0;
+            if (!altCutting) setAltCutting(TRUE);
+        }
+        // back to base cutting when pressure stayed low long enough
+        else if (altCutting && (++altCalm >= ALT_CUTTING_RELEASE_DELAY)) setAltCutting(FALSE);
+    }
+
+    // rebuild VDP sprite table (VDP sprites 1 to 'slots' are linked sequentially)
+    VDPSprite* vdpSprite = &vdpSpriteCache[1];
+    u16 link = 1;
+
+    for(i = 0; i < num; i++)
+    {
+        sprite = list[i];
+
+        // dropped
+        if (!sprite) continue;
+
+        FrameVDPSprite** frameSprites = sprite->frameInfo->frameVDPSprites;
+        u16 visibility = sprite->visibility;
+        u16 attr = sprite->attribut;
+        u16 n = sprite->frame->numSprite;
+
+        while(n--)
+        {
+            FrameVDPSprite* frameSprite = *frameSprites++;
+
+            if (visibility & 1)
+            {
+                // Y first to respect VDP field order
+                vdpSprite->y = sprite->y + frameSprite->offsetY;
+                vdpSprite->size = frameSprite->size;
+                vdpSprite->link = ++link;
+                vdpSprite->attribut = attr;
+                vdpSprite->x = sprite->x + frameSprite->offsetX;
+                vdpSprite++;
+            }
+
+            // increment tile index in attribut field
+            attr += frameSprite->numTile;
+            visibility >>= 1;
+        }
+    }
+
+    // at least one VDP sprite ?
+    if (link > 1)
+    {
+        // end link
+        vdpSprite[-1].link = 0;
+        starter->link = 1;
+    }
+    else starter->link = 0;
+
+    // need to upload the sprite table from starter to last used VDP sprite
+    satDirtyFirst = starter;
+    satDirtyLast = &vdpSpriteCache[link - 1];
+
+#ifdef SPR_PROFIL
+    profil_time[PROFIL_MULTIPLEX] += getSubTick() - prof;
+#endif // SPR_PROFIL
+}
+
+static void setAltCutting(bool value)
+{
+    Sprite* sprite = firstSprite;
+
+#if (LIB_LOG_LEVEL >= LOG_LEVEL_INFO)
+    KLog_U1("Sprite engine: alternative cutting ", value);
+#endif // LIB_DEBUG
+
+    altCutting = value;
+    altCalm = 0;
+
+    // refresh frame of sprites having an alternative cutting (done on next update)
+    while(sprite)
+    {
+        const u16 status = sprite->status;
+
+        if ((status & SPR_FLAG_AUTO_TILE_UPLOAD) && sprite->frame && sprite->animation->frames[sprite->frameInd]->alt)
+        {
+            sprite->status = status | NEED_FRAME_UPDATE;
+            SET_HOT(sprite);
+        }
+
+        sprite = sprite->next;
+    }
+}
+
+static bool multiplexFit(Sprite* sprite, u16 lineMax, u16 dotMax)
+{
+    FrameVDPSprite** frameSprites = sprite->frameInfo->frameVDPSprites;
+    const s16 ymax = screenHeight - 1;
+    const s16 numSprite = sprite->frame->numSprite;
+    const u16 visibility = sprite->visibility;
+    s16 i;
+
+    // try to add each visible VDP sprite in the bands it covers
+    for(i = 0; i < numSprite; i++)
+    {
+        if (!(visibility & (1 << i))) continue;
+
+        FrameVDPSprite* frameSprite = frameSprites[i];
+        const u16 size = frameSprite->size;
+        const u16 w = ((size & 0x0C) << 1) + 8;
+        s16 y0 = (sprite->y - 0x80) + frameSprite->offsetY;
+        s16 y1 = y0 + ((size & 0x03) << 3) + 7;
+
+        // clip to screen
+        if (y0 < 0) y0 = 0;
+        if (y1 > ymax) y1 = ymax;
+        // not vertically on screen --> don't use scanline budget
+        if (y1 < y0) continue;
+
+        const u16 b0 = y0 >> 3;
+        const u16 b1 = y1 >> 3;
+        u16 b;
+
+        // check budget
+        for(b = b0; b <= b1; b++)
+            if ((bandCount[b] >= lineMax) || ((bandDots[b] + w) > dotMax)) break;
+
+        // over budget --> rollback what we already added for this sprite and return
+        if (b <= b1)
+        {
+            while(i--)
+            {
+                if (!(visibility & (1 << i))) continue;
+
+                frameSprite = frameSprites[i];
+                const u16 rsize = frameSprite->size;
+                const u16 rw = ((rsize & 0x0C) << 1) + 8;
+                s16 ry0 = (sprite->y - 0x80) + frameSprite->offsetY;
+                s16 ry1 = ry0 + ((rsize & 0x03) << 3) + 7;
+
+                if (ry0 < 0) ry0 = 0;
+                if (ry1 > ymax) ry1 = ymax;
+                if (ry1 < ry0) continue;
+
+                for(b = ry0 >> 3; b <= (ry1 >> 3); b++)
+                {
+                    bandCount[b]--;
+                    bandDots[b] -= rw;
+                }
+            }
+
+            return FALSE;
+        }
+
+        // consume budget
+        for(b = b0; b <= b1; b++)
+        {
+            bandCount[b]++;
+            bandDots[b] += w;
+        }
+    }
+
+    return TRUE;
+}
+
+static void setAllSATDirty()
+{
+    satDirtyFirst = vdpSpriteCache;
+    satDirtyLast = &vdpSpriteCache[MAX_VDP_SPRITE - 1];
+}
+
+static u16 getSATTransferSize()
+{
+    // multiplexing rebuilds the whole sprite table
+    if (initFlag & SPR_INIT_FLAG_MULTIPLEX) return sizeof(VDPSprite) * (highestVDPSpriteIndex + 1);
+
+    VDPSprite* last = &vdpSpriteCache[highestVDPSpriteIndex];
+
+    // changes on VDP sprites above the highest allocated one are ignored
+    if (satDirtyLast < last) last = satDirtyLast;
+    // nothing to send
+    if (satDirtyFirst > last) return 0;
+
+    return sizeof(VDPSprite) * ((last - satDirtyFirst) + 1);
+}
+
+static void clearSATDirty()
+{
+    satDirtyFirst = &vdpSpriteCache[MAX_VDP_SPRITE];
+    satDirtyLast = NULL;
 }
 
 static u16 getSpriteIndex(Sprite* sprite)
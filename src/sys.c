@@ -669,6 +669,15 @@ bool SYS_doVBlankProcessEx(VBlankProcessTime processTime)
     // store back
     VBlankProcess = vbp;
 
+    // per frame scratch memory is released (DMA queue is flushed now)
+    MEM_clearFrameArena();
+    // incremental heap packing
+    MEM_doAutoPack();
+#if (MEM_TRACKING != 0)
+    // sample heap fragmentation
+    MEM_sampleStats();
+#endif
+
     // frame load display enabled ?
     if (flags & SHOW_FRAME_LOAD)
     {
@@ -213,6 +213,51 @@ void VRAM_free(VRAMRegion *region, u16 index)
 #endif
 }
 
+u16 VRAM_compactStep(VRAMRegion *region, u16 maxSize, u16 *from, u16 *to)
+{
+    u16* b;
+    u16* next;
+    u16 bsize, fsize;
+
+    // merge all free blocks
+    pack(region, SIZE_MASK);
+
+    b = region->vram;
+
+    // find first free block
+    while((bsize = *b) & USED_MASK)
+        b += bsize & SIZE_MASK;
+
+    // end of region --> nothing to compact
+    if (!bsize) return 0;
+
+    fsize = bsize;
+    next = b + fsize;
+    bsize = *next;
+
+    // no allocated block after the free block --> already compacted
+    if (!bsize) return 0;
+
+    // free blocks are merged so next block is necessarily used
+    bsize &= SIZE_MASK;
+
+    *from = ((u16) (next - region->vram)) + region->startIndex;
+    *to = ((u16) (b - region->vram)) + region->startIndex;
+
+    // too large ? --> don't move it
+    if (bsize > maxSize) return bsize;
+
+    // move used block at start of free area and put the free area just after
+    *b = bsize | USED_MASK;
+    b += bsize;
+    *b = fsize;
+
+    // set free position on the moved free area
+    region->free = b;
+
+    return bsize;
+}
+
 
 /*
  * Pack free blocks and return first matching free block
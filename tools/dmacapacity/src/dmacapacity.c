@@ -0,0 +1,68 @@
+#include <stdlib.h>
+#include <stdio.h>
+
+// library DMA unit (src/dma.c) is compiled with this test, unused (hardware dependent) code is removed at link time
+// (-ffunction-sections / --gc-sections) so only the capacity model is used
+#include "dma.h"
+
+
+typedef struct
+{
+    const char *name;
+    unsigned int width;
+    unsigned int height;
+    unsigned int pal;
+    unsigned int activeLines;
+    unsigned int expected;
+} TestCase;
+
+
+static const TestCase tests[] =
+{
+    // blank lines only
+    { "NTSC H40 V28", 320, 224, 0, 0, 7380 },
+    { "PAL H40 V28", 320, 224, 1, 0, 17835 },
+    { "PAL H40 V30", 320, 240, 1, 0, 14555 },
+    { "NTSC H32 V28", 256, 224, 0, 0, 6012 },
+    { "PAL H32 V30", 256, 240, 1, 0, 11857 },
+    // active display lines used for DMA
+    { "NTSC H40 V28 + 10 active lines", 320, 224, 0, 10, 7380 + (10 * 18) },
+    { "NTSC H32 V28 + 10 active lines", 256, 224, 0, 10, 6012 + (10 * 16) },
+    { "PAL H40 V30 + 240 active lines", 320, 240, 1, 240, 14555 + (240 * 18) },
+    // HInt slicing every 8 lines (1 slice per sliced line)
+    { "NTSC H40 V28 + slicing every 8 lines", 320, 224, 0, 224 / 8, 7380 + (28 * 18) },
+    // active lines can't exceed screen height
+    { "NTSC H40 V28 + 300 active lines", 320, 224, 0, 300, 7380 + (224 * 18) },
+    // display disabled (whole frame is blank, no active line)
+    { "NTSC H40 display off", 320, 0, 0, 0, 260 * 205 },
+    { "PAL H40 display off", 320, 0, 1, 0, 311 * 205 },
+    { "NTSC H32 display off", 256, 0, 0, 0, 260 * 167 },
+    { "NTSC H40 display off + 100 active lines", 320, 0, 0, 100, 260 * 205 },
+};
+
+
+int main(int argc, char **argv)
+{
+    int ii;
+    int numFail;
+    const int numTest = sizeof(tests) / sizeof(TestCase);
+
+    numFail = 0;
+
+    for (ii = 0; ii < numTest; ii++)
+    {
+        const TestCase *test = &tests[ii];
+        const unsigned int result = DMA_computeTransferCapacity(test->width, test->height, test->pal, test->activeLines);
+
+        if (result != test->expected)
+        {
+            printf("FAILED  %-40s got %u, expected %u\n", test->name, result, test->expected);
+            numFail++;
+        }
+        else printf("OK      %-40s %u\n", test->name, result);
+    }
+
+    printf("%d / %d test(s) passed\n", numTest - numFail, numTest);
+
+    return numFail ? 1 : 0;
+}
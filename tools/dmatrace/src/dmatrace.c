@@ -0,0 +1,279 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <inttypes.h>
+
+
+#define MAX_LINE        512
+#define MAX_SITE        4096
+#define MAX_SYMBOL      65536
+
+#define DEFAULT_TOP     10
+
+
+typedef struct
+{
+    uint32_t addr;
+    char *name;
+} Symbol;
+
+typedef struct
+{
+    uint32_t addr;
+    uint32_t bytes;
+    uint32_t ops;
+    uint32_t frames;
+    int lastFrame;
+} Site;
+
+
+static Symbol *symbols;
+static int numSymbol;
+static Site sites[MAX_SITE];
+static int numSite;
+
+
+static int compareSymbol(const void *a, const void *b)
+{
+    const Symbol *sa = a;
+    const Symbol *sb = b;
+
+    if (sa->addr < sb->addr) return -1;
+    if (sa->addr > sb->addr) return 1;
+    return 0;
+}
+
+static int compareSite(const void *a, const void *b)
+{
+    const Site *sa = a;
+    const Site *sb = b;
+
+    if (sa->bytes > sb->bytes) return -1;
+    if (sa->bytes < sb->bytes) return 1;
+    return 0;
+}
+
+// load symbols from 'nm' output (as SGDK out/symbol.txt): "address type name"
+static int loadSymbols(char *filename)
+{
+    FILE *f;
+    char line[MAX_LINE];
+    char name[MAX_LINE];
+    char type;
+    unsigned int addr;
+
+    f = fopen(filename, "rb");
+    if (!f)
+    {
+        printf("Couldn't open symbol file %s\n", filename);
+        return 0;
+    }
+
+    symbols = malloc(MAX_SYMBOL * sizeof(Symbol));
+    numSymbol = 0;
+
+    while (fgets(line, sizeof(line), f) && (numSymbol < MAX_SYMBOL))
+    {
+        if (sscanf(line, "%x %c %s", &addr, &type, name) != 3) continue;
+        // only keep code symbols
+        if ((type != 'T') && (type != 't')) continue;
+
+        symbols[numSymbol].addr = addr;
+        symbols[numSymbol].name = strdup(name);
+        numSymbol++;
+    }
+
+    fclose(f);
+
+    qsort(symbols, numSymbol, sizeof(Symbol), compareSymbol);
+
+    return 1;
+}
+
+static void getSiteName(uint32_t addr, char *out)
+{
+    int lo, hi;
+
+    if (!addr)
+    {
+        strcpy(out, "<unknown>");
+        return;
+    }
+
+    // find the last symbol before address
+    lo = 0;
+    hi = numSymbol - 1;
+    while (lo < hi)
+    {
+        int mid = (lo + hi + 1) / 2;
+
+        if (symbols[mid].addr <= addr) lo = mid;
+        else hi = mid - 1;
+    }
+
+    if (numSymbol && (symbols[lo].addr <= addr))
+        sprintf(out, "%s+0x%X (%06X)", symbols[lo].name, addr - symbols[lo].addr, addr);
+    else
+        sprintf(out, "%06X", addr);
+}
+
+static void addSite(uint32_t addr, uint32_t bytes, int frame)
+{
+    int ii;
+
+    for (ii = 0; ii < numSite; ii++)
+        if (sites[ii].addr == addr) break;
+
+    if (ii == numSite)
+    {
+        // too many sites --> merge with the first one
+        if (numSite == MAX_SITE) ii = 0;
+        else
+        {
+            memset(&sites[ii], 0, sizeof(Site));
+            sites[ii].addr = addr;
+            sites[ii].lastFrame = -1;
+            numSite++;
+        }
+    }
+
+    sites[ii].bytes += bytes;
+    sites[ii].ops++;
+    if (sites[ii].lastFrame != frame)
+    {
+        sites[ii].lastFrame = frame;
+        sites[ii].frames++;
+    }
+}
+
+
+int main(int argc, char **argv)
+{
+    int ii;
+    int top;
+    int verbose;
+    char *fileName;
+    char *symName;
+    FILE *fileInput;
+    char line[MAX_LINE];
+    char location[16];
+    char siteName[MAX_LINE];
+    unsigned int frame, lane, from, to, len, step, site;
+    unsigned int capacity, size, num;
+    uint32_t frameBytes, frameOps;
+    uint32_t totalBytes, maxBytes;
+    int numFrame, numOverflow;
+
+    // default
+    fileName = "";
+    symName = "";
+    top = DEFAULT_TOP;
+    verbose = 0;
+
+    // parse parmeters
+    for (ii = 1; ii < argc; ii++)
+    {
+        if (!strcmp(argv[ii], "-sym"))
+        {
+            ii++;
+            if (ii < argc) symName = argv[ii];
+        }
+        else if (!strcmp(argv[ii], "-top"))
+        {
+            ii++;
+            if (ii < argc) top = strtoimax(argv[ii], NULL, 0);
+        }
+        else if (!strcmp(argv[ii], "-v")) verbose = 1;
+        else if (!fileName[0]) fileName = argv[ii];
+    }
+
+    if (!fileName[0])
+    {
+        printf("DMA trace replay tool\n");
+        printf("Usage: dmatrace <trace_log> [-sym <symbol_file>] [-top <num>] [-v]\n");
+        printf("  trace_log    KDebug log containing DMA_dumpTrace() output (DMAT / DMAF lines)\n");
+        printf("  -sym         symbol file (nm output as out/symbol.txt) to resolve call sites\n");
+        printf("  -top         number of call sites to display (default = %d)\n", DEFAULT_TOP);
+        printf("  -v           display all frames (only over capacity frames otherwise)\n");
+        return 1;
+    }
+
+    if (symName[0] && !loadSymbols(symName)) return 1;
+
+    fileInput = fopen(fileName, "rb");
+    if (!fileInput)
+    {
+        printf("Couldn't open input file %s\n", fileName);
+        return 1;
+    }
+
+    frameBytes = 0;
+    frameOps = 0;
+    totalBytes = 0;
+    maxBytes = 0;
+    numFrame = 0;
+    numOverflow = 0;
+
+    printf("frame     ops   bytes  capacity  use%%\n");
+
+    while (fgets(line, sizeof(line), fileInput))
+    {
+        char *s;
+
+        // operation (emulators may prefix the log line)
+        if ((s = strstr(line, "DMAT ")))
+        {
+            if (sscanf(s, "DMAT %u %u %15s %x %x %u %u %x", &frame, &lane, location, &from, &to, &len, &step, &site) != 8) continue;
+
+            // DMA length register is in word (VRAM copy is twice slower so it's the same cost)
+            frameBytes += len * 2;
+            frameOps++;
+            addSite(site, len * 2, frame);
+        }
+        // end of flush
+        else if ((s = strstr(line, "DMAF ")))
+        {
+            int overflow;
+
+            if (sscanf(s, "DMAF %u %u %u %u", &frame, &capacity, &size, &num) != 4) continue;
+
+            overflow = capacity && (frameBytes > capacity);
+
+            if (overflow) numOverflow++;
+            if (overflow || verbose)
+                printf("%5u  %6u  %6u  %8u  %3u%s\n", frame, frameOps, frameBytes, capacity,
+                    capacity ? (frameBytes * 100) / capacity : 0, overflow ? "  OVER" : "");
+
+            totalBytes += frameBytes;
+            if (frameBytes > maxBytes) maxBytes = frameBytes;
+            numFrame++;
+
+            frameBytes = 0;
+            frameOps = 0;
+        }
+    }
+
+    fclose(fileInput);
+
+    if (!numFrame)
+    {
+        printf("No DMA trace found in %s\n", fileName);
+        return 1;
+    }
+
+    printf("\n%d frame(s), %d over capacity - mean = %u bytes/frame, max = %u bytes/frame\n", numFrame, numOverflow,
+        totalBytes / numFrame, maxBytes);
+
+    // top offenders
+    qsort(sites, numSite, sizeof(Site), compareSite);
+
+    printf("\nTop call sites:\n");
+    printf("   bytes     ops  frames  site\n");
+    for (ii = 0; (ii < numSite) && (ii < top); ii++)
+    {
+        getSiteName(sites[ii].addr, siteName);
+        printf("%8u  %6u  %6u  %s\n", sites[ii].bytes, sites[ii].ops, sites[ii].frames, siteName);
+    }
+
+    return 0;
+}
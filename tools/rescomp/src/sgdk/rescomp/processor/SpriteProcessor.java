@@ -28,7 +28,7 @@ public class SpriteProcessor implements Processor
         if (fields.length < 5)
         {
             System.out.println("Wrong SPRITE definition");
-            System.out.println("SPRITE name \"file\" width heigth [compression [time [collision [opt [iteration]]]]]");
+            System.out.println("SPRITE name \"file\" width heigth [compression [time [collision [opt [iteration [altcut]]]]]]");
             System.out.println("  name          Sprite variable name");
             System.out.println(
                     "  file          the image file to convert to SpriteDefinition structure (should be a 8bpp .bmp or .png)");
@@ -54,6 +54,8 @@ public class SpriteProcessor implements Processor
                     "                  3 / NONE      = no optimization (cover the whole sprite frame)");
             System.out
                     .println("  iteration     number of iteration for sprite cutting optimization (default = 500000)");
+            System.out.println(
+                    "  altcut        also build an alternative cutting using less hardware sprites for each frame (FALSE by default)");
 
             return null;
         }
@@ -106,6 +108,13 @@ public class SpriteProcessor implements Processor
         if (fields.length >= 10)
             iteration = StringUtil.parseInt(fields[9], SpriteFrame.DEFAULT_SPRITE_OPTIMIZATION_NUM_ITERATION);
 
+        // get alternative cutting value
+        boolean altCut = false;
+        if (fields.length >= 11)
+            altCut = StringUtil.parseBoolean(fields[10], altCut);
+        // applied to all frames of this sprite
+        SpriteFrame.altCut = altCut;
+
         // add resource file (used for deps generation)
         Compiler.addResourceFile(fileIn);
         
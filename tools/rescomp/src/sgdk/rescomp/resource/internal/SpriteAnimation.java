@@ -17,6 +17,10 @@ public class SpriteAnimation extends Resource
     public final List<SpriteFrame> frames;
     public final byte[] sequence;
     public int loopIndex;
+    // start tick of each sequence step (flattened frame timers)
+    public final int[] timeline;
+    // total duration in frame (0 if animation isn't automatic, i.e. a frame doesn't define timer)
+    public final int duration;
 
     final int hc;
 
@@ -76,10 +80,51 @@ public class SpriteAnimation extends Resource
         for (int s = 0; s < sequence.length; s++)
             sequence[s] = sequenceList.get(s).byteValue();
 
+        // build timeline
+        timeline = buildTimeline();
+        duration = computeDuration();
+
         // compute hash code
         hc = loopIndex ^ Arrays.hashCode(sequence) ^ frames.hashCode();
     }
 
+    private int[] buildTimeline()
+    {
+        final int[] result = new int[sequence.length];
+        int tick = 0;
+
+        for (int s = 0; s < sequence.length; s++)
+        {
+            result[s] = tick;
+            tick += frames.get(sequence[s]).timer;
+        }
+
+        return result;
+    }
+
+    private int computeDuration()
+    {
+        int result = 0;
+
+        for (int s = 0; s < sequence.length; s++)
+        {
+            final int timer = frames.get(sequence[s]).timer;
+
+            // frame without timer --> animation doesn't loop automatically
+            if (timer == 0)
+                return 0;
+
+            result += timer;
+        }
+
+        return result;
+    }
+
+    private int getTimelineSize()
+    {
+        return (duration > 0) ? (timeline.length * 2) : 0;
+    }
+
     public boolean isEmpty()
     {
         return frames.isEmpty();
@@ -95,7 +140,7 @@ public class SpriteAnimation extends Resource
         int result = 0;
 
         for (SpriteFrame frame : frames)
-            result = Math.max(result, frame.getNumTile());
+            result = Math.max(result, frame.getMaxNumTile());
 
         return result;
     }
@@ -139,7 +184,7 @@ public class SpriteAnimation extends Resource
     @Override
     public int shallowSize()
     {
-        return (frames.size() * 4) + sequence.length + (sequence.length & 1);
+        return (frames.size() * 4) + sequence.length + (sequence.length & 1) + getTimelineSize();
     }
 
     @Override
@@ -173,6 +218,9 @@ public class SpriteAnimation extends Resource
 
         outS.append("\n");
 
+        // timeline data (only for automatic animation)
+        outTimeline(outS, outH);
+
         // Animation structure
         Util.decl(outS, outH, "Animation", id, 2, global);
         // set number of frame
@@ -185,7 +233,29 @@ public class SpriteAnimation extends Resource
         outS.append("    dc.l    " + id + "_sequence\n");
         // loop info
         outS.append("    dc.w    " + loopIndex + "\n");
+        // timeline info
+        outTimelineInfo(outS);
 
         outS.append("\n");
     }
+
+    private void outTimeline(StringBuilder outS, StringBuilder outH)
+    {
+        if (duration > 0)
+        {
+            Util.decl(outS, outH, null, id + "_timeline", 2, false);
+            for (int tick : timeline)
+                outS.append("    dc.w    " + tick + "\n");
+
+            outS.append("\n");
+        }
+    }
+
+    private void outTimelineInfo(StringBuilder outS)
+    {
+        // set timeline pointer
+        outS.append("    dc.l    " + ((duration > 0) ? (id + "_timeline") : "0") + "\n");
+        // total duration
+        outS.append("    dc.w    " + duration + "\n");
+    }
 }
\ No newline at end of file
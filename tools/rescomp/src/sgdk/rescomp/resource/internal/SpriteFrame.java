@@ -21,6 +21,8 @@ import sgdk.tool.ImageUtil;
 public class SpriteFrame extends Resource
 {
     public static final int DEFAULT_SPRITE_OPTIMIZATION_NUM_ITERATION = 500000;
+    // also build an alternative cutting using less VDP sprites for new frames (set from SPRITE 'altcut' option)
+    public static boolean altCut = false;
 
     public final SpriteFrameInfo frameInfo;
     public final SpriteFrameInfo frameInfoH;
@@ -30,6 +32,8 @@ public class SpriteFrame extends Resource
     public final int w; // width of frame in tile
     public final int h; // height of frame in tile
     public final int timer;
+    // alternative cutting using less (but larger) VDP sprites (null if none)
+    public final SpriteFrame alt;
 
     final int hc;
 
@@ -86,6 +90,7 @@ public class SpriteFrame extends Resource
             frameInfoH = null;
             frameInfoV = null;
             frameInfoHV = null;
+            alt = null;
             hc = 0;
 
             return;
@@ -139,8 +144,32 @@ public class SpriteFrame extends Resource
         frameInfoHV = (SpriteFrameInfo) addInternalResource(
                 SpriteFrameInfo.getSpriteFrameInfo(id + "_hvflip", frameInfo, wf, hf, true, true, opt));
 
+        // alternative cutting (used by the sprite engine under hardware sprite pressure)
+        alt = buildAlt(id, image8bpp, w, h, frameIndex, animIndex, wf, hf, timer, collisionType, compression,
+                optIteration);
+
         hc = (h << 0) ^ (w << 8) ^ (timer << 16) ^ tileset.hashCode() ^ frameInfo.hashCode() ^ frameInfoH.hashCode()
-                ^ frameInfoV.hashCode() ^ frameInfoHV.hashCode();
+                ^ frameInfoV.hashCode() ^ frameInfoHV.hashCode() ^ ((alt != null) ? alt.hashCode() : 0);
+    }
+
+    private SpriteFrame buildAlt(String id, byte[] image8bpp, int w, int h, int frameIndex, int animIndex, int wf,
+            int hf, int timer, CollisionType collisionType, Compression compression, long optIteration)
+    {
+        // not requested or can't use less VDP sprite
+        if (!altCut || (getNumSprite() <= 1))
+            return null;
+
+        // minimize the number of VDP sprite (no alternative cutting of the alternative cutting)
+        altCut = false;
+        final SpriteFrame result = new SpriteFrame(id + "_alt", image8bpp, w, h, frameIndex, animIndex, wf, hf, timer,
+                collisionType, compression, OptimizationType.MIN_SPRITE, optIteration);
+        altCut = true;
+
+        // not better ? --> no alternative cutting
+        if (result.getNumSprite() >= getNumSprite())
+            return null;
+
+        return (SpriteFrame) addInternalResource(result);
     }
 
     public int getNumSprite()
@@ -158,6 +187,14 @@ public class SpriteFrame extends Resource
         return isEmpty() ? 0 : tileset.getNumTile();
     }
 
+    /**
+     * Maximum number of tile used by this frame (alternative cutting included)
+     */
+    public int getMaxNumTile()
+    {
+        return (alt != null) ? Math.max(getNumTile(), alt.getNumTile()) : getNumTile();
+    }
+
     @Override
     public int internalHashCode()
     {
@@ -173,7 +210,8 @@ public class SpriteFrame extends Resource
             return (w == spriteFrame.w) && (h == spriteFrame.h) && (timer == spriteFrame.timer)
                     && tileset.equals(spriteFrame.tileset) && frameInfo.equals(spriteFrame.frameInfo)
                     && frameInfoH.equals(spriteFrame.frameInfoH) && frameInfoV.equals(spriteFrame.frameInfoV)
-                    && frameInfoHV.equals(spriteFrame.frameInfoHV);
+                    && frameInfoHV.equals(spriteFrame.frameInfoHV)
+                    && ((alt != null) ? alt.equals(spriteFrame.alt) : (spriteFrame.alt == null));
         }
 
         return false;
@@ -188,7 +226,7 @@ public class SpriteFrame extends Resource
     @Override
     public int shallowSize()
     {
-        return 2 + 2 + (4 * 4 * 2) + 4;
+        return 2 + 2 + (4 * 4 * 2) + 4 + 4;
     }
 
     @Override
@@ -208,6 +246,9 @@ public class SpriteFrame extends Resource
         if (frameInfoHV.collision != null)
             result += frameInfoHV.collision.totalSize();
 
+        if (alt != null)
+            result += alt.totalSize();
+
         return result + shallowSize();
     }
 
@@ -239,6 +280,8 @@ public class SpriteFrame extends Resource
 
         // set tileset pointer
         outS.append("    dc.l    " + tileset.id + "\n");
+        // set alternative cutting pointer
+        outS.append("    dc.l    " + ((alt != null) ? alt.id : "0") + "\n");
 
         outS.append("\n");
     }